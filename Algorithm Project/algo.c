@@ -1,9 +1,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
-#define MAX_PRODUCTS 10
-#define MAX_LINES 4
+#define DEFAULT_PRODUCTS 10  // Products in made-up logs unless told otherwise
 #define MAX_EMPLOYEES 10
 
 // Define a structure to represent log entry
@@ -21,129 +28,1486 @@ typedef struct {
     char resolution_description[50];
 } LogEntry;
 
-// Compare function for merge sort
-int compare(const void *a, const void *b) {
-    const LogEntry *entry1 = (const LogEntry *)a;
-    const LogEntry *entry2 = (const LogEntry *)b;
+// Date & time packed into one number that orders the same way as compare():
+// year in bits 20-31, month 16-19, day 11-15, hour 6-10, minute 0-5
+#define PACK_TIME(year, month, day, hour, minute) \
+    ((uint32_t)(year) << 20 | (uint32_t)(month) << 16 | (uint32_t)(day) << 11 | (uint32_t)(hour) << 6 | (uint32_t)(minute))
+#define TIME_YEAR(t) ((int)((t) >> 20))
+#define TIME_MONTH(t) ((int)((t) >> 16 & 15))
+#define TIME_DAY(t) ((int)((t) >> 11 & 31))
+#define TIME_HOUR(t) ((int)((t) >> 6 & 31))
+#define TIME_MINUTE(t) ((int)((t) & 63))
 
-    // Compare dates
-    if (entry1->year != entry2->year) return entry1->year - entry2->year;
-    if (entry1->month != entry2->month) return entry1->month - entry2->month;
-    if (entry1->day != entry2->day) return entry1->day - entry2->day;
+// Compact form of a log entry, 24 bytes instead of ~330, so millions of rows stay cheap to scan and move
+typedef struct {
+    uint32_t timestamp;               // PACK_TIME() of the date & time
+    uint32_t product_id;
+    uint16_t issue_code;
+    uint8_t line_id;
+    uint8_t num_employees;
+    uint32_t employees;               // Index of the row's first employee ID in the table's employee list
+    uint32_t issue_description;       // Offsets of the descriptions in the table's string pool
+    uint32_t resolution_description;
+} CompactLog;
+
+// Sort key: a row's timestamp next to its index, so sorting moves 8 bytes per row instead of the row
+typedef struct {
+    uint32_t timestamp;
+    uint32_t row;
+} SortKey;
+
+// Slot of the string intern table
+typedef struct {
+    uint32_t offset;    // Pool offset of the string plus one, 0 marks an empty slot
+    int32_t employee;   // Employee ID if the string is an employee name, else -1
+} InternSlot;
 
-    // Compare times
-    if (entry1->hour != entry2->hour) return entry1->hour - entry2->hour;
-    return entry1->minute - entry2->minute;
+// Slot of an ID index
+typedef struct {
+    uint64_t key;
+    int32_t id;     // -1 marks an empty slot
+} IdSlot;
+
+// Open-addressing hash from any 64-bit key (an ID, or several packed together) to a dense ID:
+// 0, 1, 2... in the order keys were first seen, so per-key data can live in plain arrays
+typedef struct {
+    IdSlot *slots;
+    size_t capacity;    // Slots, a power of two
+    int count;          // IDs handed out so far
+} IdIndex;
+
+// Earliest and latest row of a group of logs, with their times so comparing needs no row
+typedef struct {
+    uint32_t earliest_time;
+    uint32_t earliest_row;
+    uint32_t latest_time;
+    uint32_t latest_row;
+} TimeSpan;
+
+// Earliest and latest row per key, kept up to date as rows are added
+typedef struct {
+    IdIndex ids;
+    TimeSpan *spans;    // Indexed by the key's ID
+    size_t capacity;
+} SpanIndex;
+
+// All the logs in compact form, plus the strings they point into
+typedef struct {
+    CompactLog *rows;
+    int num_logs;
+    int capacity;
+    uint16_t *employee_ids;     // Employee lists of all the rows, back to back
+    size_t num_employee_ids;
+    size_t employee_ids_capacity;
+    char *pool;                 // Every distinct string once, NUL-terminated
+    size_t pool_size;
+    size_t pool_capacity;
+    uint32_t *names;            // Pool offset of each employee name, indexed by employee ID
+    int num_names;
+    int names_capacity;
+    InternSlot *intern;         // Open-addressing table of the pool's strings
+    size_t intern_capacity;     // Slots, a power of two
+    size_t intern_used;
+    SortKey *order;             // Rows in date & time order, valid while sorted is set
+    int sorted;                 // Cleared by every append, so reports only sort when something changed
+    SpanIndex by_product;       // Earliest and latest row per product,
+    SpanIndex by_product_line;  // per product and line,
+    SpanIndex by_product_issue; // and per product and issue code
+} LogTable;
+
+// Keys of the span indexes
+#define PRODUCT_LINE_KEY(product_id, line_id) ((uint64_t)(product_id) << 32 | (uint32_t)(line_id))
+#define PRODUCT_ISSUE_KEY(product_id, issue_code) ((uint64_t)(product_id) << 32 | (uint32_t)(issue_code))
+
+// Function to get the current time in seconds, for the load statistics
+double nowSeconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-// Function to sort logs by date & time
-void sortLogs(LogEntry *logs, int num_logs) {
-    qsort(logs, num_logs, sizeof(LogEntry), compare);
+// Function to grow an array to hold at least needed items, doubling so appends stay cheap overall
+// Returns 0 on success, -1 if memory runs out (the array is left as it was)
+int growArray(void **array, size_t *capacity, size_t needed, size_t item_size) {
+    if (needed <= *capacity) return 0;
+    size_t grown = *capacity ? *capacity : 1024;
+    while (grown < needed) grown *= 2;
+    void *larger = realloc(*array, grown * item_size);
+    if (larger == NULL) return -1;
+    *array = larger;
+    *capacity = grown;
+    return 0;
 }
 
-// Function to report issue codes by product ID and line ID, sorted by line and product ID
-void reportIssues(LogEntry *logs, int num_logs) {
-    // Sort logs by date & time
-    sortLogs(logs, num_logs);
+// Function to mix the bits of a key, so consecutive IDs spread over the whole table
+uint64_t hashKey(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    return key ^ (key >> 33);
+}
 
-    // Print the report header
-    printf("Issue Reports by Product ID and Line ID:\n");
+// Function to find the slot of a key, or the empty slot where it belongs
+IdSlot *findIdSlot(const IdIndex *index, uint64_t key) {
+    size_t mask = index->capacity - 1;
+    size_t i = hashKey(key) & mask;
+    while (index->slots[i].id >= 0 && index->slots[i].key != key) i = (i + 1) & mask;
+    return &index->slots[i];
+}
 
-    // Initialize hash map for product_id and line_id
-    int issue_map[MAX_PRODUCTS][MAX_LINES] = {0};
+// Function to look up the ID of a key, -1 if it has none
+int findId(const IdIndex *index, uint64_t key) {
+    if (index->capacity == 0) return -1;
+    return findIdSlot(index, key)->id;
+}
 
-    // Iterate through logs to populate the map
-    for (int i = 0; i < num_logs; i++) {
-        issue_map[logs[i].product_id][logs[i].line_id] = logs[i].issue_code;
+// Function to get the ID of a key, giving it the next free ID if it is new (-1 if memory runs out)
+int insertId(IdIndex *index, uint64_t key) {
+    if ((size_t)(index->count + 1) * 2 > index->capacity) {
+        // Keep the table at most half full so probe runs stay short, rehash into double the size
+        size_t old_capacity = index->capacity;
+        IdSlot *old = index->slots;
+        size_t capacity = old_capacity ? old_capacity * 2 : 64;
+        IdSlot *slots = malloc(capacity * sizeof(IdSlot));
+        if (slots == NULL) return -1;
+        for (size_t i = 0; i < capacity; i++) slots[i].id = -1;
+        index->slots = slots;
+        index->capacity = capacity;
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].id >= 0) *findIdSlot(index, old[i].key) = old[i];
+        }
+        free(old);
     }
+    IdSlot *slot = findIdSlot(index, key);
+    if (slot->id < 0) {
+        slot->key = key;
+        slot->id = index->count++;
+    }
+    return slot->id;
+}
 
-    // Print the report
-    for (int i = 0; i < MAX_PRODUCTS; i++) {
-        for (int j = 0; j < MAX_LINES; j++) {
-            if (issue_map[i][j] != 0) {
-                printf("Product ID: %d, Line ID: %d, Issue Code: %d\n",
-                       i + 1, j + 1, issue_map[i][j]);
-            }
+// Function to free an ID index
+void freeIdIndex(IdIndex *index) {
+    free(index->slots);
+    memset(index, 0, sizeof(*index));
+}
+
+// Function to record a row in the span of its key, returns 0 on success
+// Ties keep the first row added as earliest and the last as latest, matching the stable sort order
+int updateSpan(SpanIndex *index, uint64_t key, uint32_t time, uint32_t row) {
+    int before = index->ids.count;
+    int id = insertId(&index->ids, key);
+    if (id < 0) return -1;
+    if (id == before) {
+        if (growArray((void **)&index->spans, &index->capacity, id + 1, sizeof(TimeSpan)) != 0) return -1;
+        index->spans[id] = (TimeSpan){time, row, time, row};
+        return 0;
+    }
+    TimeSpan *span = &index->spans[id];
+    if (time < span->earliest_time) {
+        span->earliest_time = time;
+        span->earliest_row = row;
+    }
+    if (time >= span->latest_time) {
+        span->latest_time = time;
+        span->latest_row = row;
+    }
+    return 0;
+}
+
+// Function to look up the span of a key, NULL if no row has it
+const TimeSpan *findSpan(const SpanIndex *index, uint64_t key) {
+    int id = findId(&index->ids, key);
+    return id < 0 ? NULL : &index->spans[id];
+}
+
+// Function to free a span index
+void freeSpanIndex(SpanIndex *index) {
+    freeIdIndex(&index->ids);
+    free(index->spans);
+    index->spans = NULL;
+    index->capacity = 0;
+}
+
+// Function to hash a string (FNV-1a)
+uint32_t hashString(const char *s, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) hash = (hash ^ (unsigned char)s[i]) * 16777619u;
+    return hash;
+}
+
+// Function to find the intern slot of a string, or the empty slot where it belongs
+InternSlot *findInternSlot(LogTable *table, const char *s, size_t len) {
+    size_t mask = table->intern_capacity - 1;
+    size_t i = hashString(s, len) & mask;
+    while (table->intern[i].offset != 0) {
+        const char *stored = table->pool + table->intern[i].offset - 1;
+        if (strncmp(stored, s, len) == 0 && stored[len] == '\0') break;
+        i = (i + 1) & mask;
+    }
+    return &table->intern[i];
+}
+
+// Function to add a string to the pool once, returns its slot (NULL if memory runs out)
+InternSlot *internString(LogTable *table, const char *s) {
+    size_t len = strlen(s);
+    if ((table->intern_used + 1) * 4 > table->intern_capacity * 3) {
+        // Keep the table under 75% full: double it and put every string back in
+        InternSlot *old = table->intern;
+        size_t old_capacity = table->intern_capacity;
+        table->intern_capacity = old_capacity ? old_capacity * 2 : 1024;
+        table->intern = calloc(table->intern_capacity, sizeof(InternSlot));
+        if (table->intern == NULL) {
+            table->intern = old;
+            table->intern_capacity = old_capacity;
+            return NULL;
         }
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (old[i].offset == 0) continue;
+            const char *stored = table->pool + old[i].offset - 1;
+            *findInternSlot(table, stored, strlen(stored)) = old[i];
+        }
+        free(old);
     }
-    printf("\n");
+
+    InternSlot *slot = findInternSlot(table, s, len);
+    if (slot->offset != 0) return slot;
+    if (growArray((void **)&table->pool, &table->pool_capacity, table->pool_size + len + 1, 1) != 0) return NULL;
+    memcpy(table->pool + table->pool_size, s, len + 1);
+    slot->offset = table->pool_size + 1;
+    slot->employee = -1;
+    table->pool_size += len + 1;
+    table->intern_used++;
+    return slot;
 }
 
-// Function to find the earliest occurrence of an issue code for a given product ID across all lines
-int findEarliestIssue(LogEntry *logs, int num_logs, int product_id) {
-    int earliest_time = -1;
+// Function to get the ID of an employee name, giving new names the next free ID (-1 if out of memory)
+int employeeId(LogTable *table, const char *name) {
+    InternSlot *slot = internString(table, name);
+    if (slot == NULL) return -1;
+    if (slot->employee < 0) {
+        size_t capacity = table->names_capacity;
+        if (table->num_names > UINT16_MAX ||
+            growArray((void **)&table->names, &capacity, table->num_names + 1, sizeof(uint32_t)) != 0) {
+            return -1;
+        }
+        table->names_capacity = capacity;
+        table->names[table->num_names] = slot->offset - 1;
+        slot->employee = table->num_names++;
+    }
+    return slot->employee;
+}
 
-    // Iterate through logs to find the earliest occurrence
-    for (int i = 0; i < num_logs; i++) {
-        if (logs[i].product_id == product_id && (earliest_time == -1 || compare(&logs[i], &logs[earliest_time]) < 0)) {
-            earliest_time = i;
+// Function to add a compact row to the table, with its employee IDs (row->employees is filled in here)
+// Returns 0 on success, -2 if memory runs out
+int appendRow(LogTable *table, const CompactLog *row, const uint16_t *employee_ids) {
+    size_t capacity = table->capacity;
+    if (growArray((void **)&table->rows, &capacity, table->num_logs + 1, sizeof(CompactLog)) != 0 ||
+        growArray((void **)&table->employee_ids, &table->employee_ids_capacity,
+                  table->num_employee_ids + row->num_employees, sizeof(uint16_t)) != 0) {
+        return -2;
+    }
+    table->capacity = capacity;
+    CompactLog *stored = &table->rows[table->num_logs];
+    *stored = *row;
+    stored->employees = table->num_employee_ids;
+    memcpy(table->employee_ids + table->num_employee_ids, employee_ids, row->num_employees * sizeof(uint16_t));
+
+    // Keep the earliest/latest indexes current, so lookups never have to scan the rows
+    uint32_t id = table->num_logs;
+    if (updateSpan(&table->by_product, row->product_id, row->timestamp, id) != 0 ||
+        updateSpan(&table->by_product_line, PRODUCT_LINE_KEY(row->product_id, row->line_id), row->timestamp, id) != 0 ||
+        updateSpan(&table->by_product_issue, PRODUCT_ISSUE_KEY(row->product_id, row->issue_code), row->timestamp, id) != 0) {
+        return -2;
+    }
+    table->num_employee_ids += row->num_employees;
+    table->num_logs++;
+    table->sorted = 0;
+    return 0;
+}
+
+// Function to add a log entry to the table in compact form
+// Returns 0 on success, -1 if a value doesn't fit the compact fields, -2 if memory runs out
+int appendLog(LogTable *table, const LogEntry *entry) {
+    if (entry->product_id < 0 || entry->line_id < 0 || entry->line_id > UINT8_MAX ||
+        entry->issue_code < 0 || entry->issue_code > UINT16_MAX ||
+        entry->year < 0 || entry->year > 4095 || entry->month < 1 || entry->month > 12 ||
+        entry->day < 1 || entry->day > 31 || entry->hour < 0 || entry->hour > 23 ||
+        entry->minute < 0 || entry->minute > 59) {
+        return -1;
+    }
+    CompactLog row;
+    uint16_t employee_ids[MAX_EMPLOYEES];
+    row.timestamp = PACK_TIME(entry->year, entry->month, entry->day, entry->hour, entry->minute);
+    row.product_id = entry->product_id;
+    row.issue_code = entry->issue_code;
+    row.line_id = entry->line_id;
+    row.num_employees = 0;
+    for (int j = 0; j < MAX_EMPLOYEES; j++) {
+        if (entry->employee[j][0] == '\0') continue;
+        int id = employeeId(table, entry->employee[j]);
+        if (id < 0) return -2;
+        employee_ids[row.num_employees++] = id;
+    }
+    InternSlot *issue = internString(table, entry->issue_description);
+    if (issue == NULL) return -2;
+    row.issue_description = issue->offset - 1;
+    InternSlot *resolution = internString(table, entry->resolution_description);
+    if (resolution == NULL) return -2;
+    row.resolution_description = resolution->offset - 1;
+    return appendRow(table, &row, employee_ids);
+}
+
+// Function to get the name of the j-th employee of a row
+const char *employeeName(const LogTable *table, const CompactLog *row, int j) {
+    return table->pool + table->names[table->employee_ids[row->employees + j]];
+}
+
+// Function to free everything the table holds
+void freeLogTable(LogTable *table) {
+    free(table->rows);
+    free(table->employee_ids);
+    free(table->pool);
+    free(table->names);
+    free(table->intern);
+    free(table->order);
+    freeSpanIndex(&table->by_product);
+    freeSpanIndex(&table->by_product_line);
+    freeSpanIndex(&table->by_product_issue);
+    memset(table, 0, sizeof(*table));
+}
+
+// Function to sort logs by date & time: fills table->order, the rows themselves stay where they are
+// LSD radix sort on the packed timestamp, one pass per byte, skipping bytes that are the same in every row
+// (a month of logs shares its year and month). Stable, so rows with equal times keep their load order.
+// Returns 0 on success, -1 if memory runs out
+int sortLogs(LogTable *table) {
+    if (table->sorted) return 0;
+    int n = table->num_logs;
+    free(table->order);
+    table->order = malloc((n ? n : 1) * sizeof(SortKey));
+    SortKey *scratch = malloc((n ? n : 1) * sizeof(SortKey));
+    if (table->order == NULL || scratch == NULL) {
+        free(scratch);
+        return -1;
+    }
+
+    // One pass over the rows builds the keys and the histograms of all four bytes
+    int counts[4][256] = {{0}};
+    for (int i = 0; i < n; i++) {
+        uint32_t t = table->rows[i].timestamp;
+        table->order[i].timestamp = t;
+        table->order[i].row = i;
+        counts[0][t & 255]++;
+        counts[1][t >> 8 & 255]++;
+        counts[2][t >> 16 & 255]++;
+        counts[3][t >> 24]++;
+    }
+
+    SortKey *src = table->order;
+    SortKey *dst = scratch;
+    for (int pass = 0; pass < 4; pass++) {
+        int *count = counts[pass];
+        int shift = pass * 8;
+        if (n == 0 || count[src[0].timestamp >> shift & 255] == n) continue;  // Every key has this byte
+        int offset = 0;
+        for (int b = 0; b < 256; b++) {
+            int c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (int i = 0; i < n; i++) dst[count[src[i].timestamp >> shift & 255]++] = src[i];
+        SortKey *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    table->order = src;
+    free(dst);
+    table->sorted = 1;
+    return 0;
+}
+
+// Key of a (product, line, issue code) group; sorting keys orders groups by product, then line, then issue code
+#define GROUP_KEY(product_id, line_id, issue_code) \
+    ((uint64_t)(product_id) << 32 | (uint64_t)(line_id) << 16 | (uint64_t)(issue_code))
+#define GROUP_PRODUCT(key) ((uint32_t)((key) >> 32))
+#define GROUP_LINE(key) ((int)((key) >> 16 & 255))
+#define GROUP_ISSUE(key) ((int)((key) & 65535))
+
+// Aggregates of a set of logs: number of logs per (product, line, issue code) for any IDs,
+// earliest and latest log of each product, and number of logs each employee is on
+typedef struct {
+    IdIndex groups;         // Group key to group ID
+    uint64_t *keys;         // Key of each group, by group ID
+    int *counts;            // Logs in each group, by group ID
+    size_t capacity;
+    SpanIndex products;     // Earliest and latest row of each product
+    int *employee_counts;   // By employee ID
+    int num_employees;
+} IssueStats;
+
+// One group of a finished aggregate, for printing in order
+typedef struct {
+    uint64_t key;
+    int count;
+} IssueGroup;
+
+// Number of threads the reports aggregate with (-j), 1 keeps everything on the main thread
+int num_threads = 1;
+int show_timing = 0;  // Sort and aggregation times go to stderr (for log files, not the sample)
+
+// Function to set up an empty aggregate for the logs of a table, returns 0 on success
+int initIssueStats(IssueStats *stats, const LogTable *table) {
+    memset(stats, 0, sizeof(*stats));
+    stats->num_employees = table->num_names;
+    stats->employee_counts = calloc(table->num_names ? table->num_names : 1, sizeof(int));
+    return stats->employee_counts != NULL ? 0 : -1;
+}
+
+// Function to free an aggregate
+void freeIssueStats(IssueStats *stats) {
+    freeIdIndex(&stats->groups);
+    free(stats->keys);
+    free(stats->counts);
+    freeSpanIndex(&stats->products);
+    free(stats->employee_counts);
+    memset(stats, 0, sizeof(*stats));
+}
+
+// Function to add n logs to a group, returns 0 on success (-1 if memory runs out)
+int addToGroup(IssueStats *stats, uint64_t key, int n) {
+    int before = stats->groups.count;
+    int id = insertId(&stats->groups, key);
+    if (id < 0) return -1;
+    if (id == before) {
+        size_t capacity = stats->capacity;
+        if (growArray((void **)&stats->keys, &capacity, id + 1, sizeof(uint64_t)) != 0 ||
+            growArray((void **)&stats->counts, &stats->capacity, id + 1, sizeof(int)) != 0) {
+            return -1;
         }
+        stats->keys[id] = key;
+        stats->counts[id] = 0;
     }
+    stats->counts[id] += n;
+    return 0;
+}
 
-    return earliest_time;
+// Function to count one row of the table, returns 0 on success (-1 if memory runs out)
+int countIssue(IssueStats *stats, const LogTable *table, uint32_t row) {
+    const CompactLog *log = &table->rows[row];
+    if (addToGroup(stats, GROUP_KEY(log->product_id, log->line_id, log->issue_code), 1) != 0 ||
+        updateSpan(&stats->products, log->product_id, log->timestamp, row) != 0) {
+        return -1;
+    }
+    for (int j = 0; j < log->num_employees; j++) stats->employee_counts[table->employee_ids[log->employees + j]]++;
+    return 0;
 }
 
-// Function to summarize the number of issues reported for each product across all lines
-void summarizeIssues(LogEntry *logs, int num_logs) {
-    // Sort logs by date & time
-    sortLogs(logs, num_logs);
+// Function to count rows begin to end - 1, or the rows at those positions of order if it isn't NULL
+int buildIssueStats(const LogTable *table, const SortKey *order, int begin, int end, IssueStats *stats) {
+    for (int i = begin; i < end; i++) {
+        if (countIssue(stats, table, order != NULL ? order[i].row : (uint32_t)i) != 0) return -1;
+    }
+    return 0;
+}
+
+// Function to add one aggregate into another, returns 0 on success (-1 if memory runs out)
+// The result is the same as counting both sets of rows into one aggregate
+int mergeIssueStats(IssueStats *into, const IssueStats *from) {
+    for (int id = 0; id < from->groups.count; id++) {
+        if (addToGroup(into, from->keys[id], from->counts[id]) != 0) return -1;
+    }
+    for (size_t i = 0; i < from->products.ids.capacity; i++) {
+        const IdSlot *slot = &from->products.ids.slots[i];
+        if (slot->id < 0) continue;
+        const TimeSpan *span = &from->products.spans[slot->id];
+        int before = into->products.ids.count;
+        int id = insertId(&into->products.ids, slot->key);
+        if (id < 0) return -1;
+        if (id == before) {
+            if (growArray((void **)&into->products.spans, &into->products.capacity, id + 1, sizeof(TimeSpan)) != 0) return -1;
+            into->products.spans[id] = *span;
+            continue;
+        }
+        // Equal times go to the lower row for earliest and the higher one for latest, as in one pass over the rows
+        TimeSpan *mine = &into->products.spans[id];
+        if (span->earliest_time < mine->earliest_time ||
+            (span->earliest_time == mine->earliest_time && span->earliest_row < mine->earliest_row)) {
+            mine->earliest_time = span->earliest_time;
+            mine->earliest_row = span->earliest_row;
+        }
+        if (span->latest_time > mine->latest_time ||
+            (span->latest_time == mine->latest_time && span->latest_row > mine->latest_row)) {
+            mine->latest_time = span->latest_time;
+            mine->latest_row = span->latest_row;
+        }
+    }
+    for (int e = 0; e < from->num_employees && e < into->num_employees; e++) {
+        into->employee_counts[e] += from->employee_counts[e];
+    }
+    return 0;
+}
 
-    // Initialize hash map for product_id and count of issues
-    int issue_count[MAX_PRODUCTS] = {0};
+// Work of one aggregation thread: a contiguous run of positions and its own aggregate
+typedef struct {
+    const LogTable *table;
+    const SortKey *order;
+    int begin;
+    int end;
+    IssueStats stats;
+    int result;
+    pthread_t thread;
+    int started;        // Running on its own thread, so it needs joining
+} StatsTask;
 
-    // Iterate through logs to count the occurrences of issues
-    for (int i = 0; i < num_logs; i++) {
-        issue_count[logs[i].product_id]++;
+// Function run by each aggregation thread
+void *statsThread(void *arg) {
+    StatsTask *task = arg;
+    task->result = initIssueStats(&task->stats, task->table);
+    if (task->result == 0) task->result = buildIssueStats(task->table, task->order, task->begin, task->end, &task->stats);
+    return NULL;
+}
+
+// Function to aggregate positions begin to end - 1 (as for buildIssueStats) on num_threads threads
+// Each thread counts its own chunk into a private aggregate, so nothing is shared until the merge
+int buildIssueStatsParallel(const LogTable *table, const SortKey *order, int begin, int end, IssueStats *stats) {
+    if (initIssueStats(stats, table) != 0) return -1;
+    int threads = num_threads;
+    if (threads > (end - begin) / 4096) threads = (end - begin) / 4096;  // Small inputs aren't worth a thread
+    if (threads <= 1) return buildIssueStats(table, order, begin, end, stats);
+
+    StatsTask *tasks = calloc(threads, sizeof(StatsTask));
+    if (tasks == NULL) return -1;
+    for (int t = 0; t < threads; t++) {
+        tasks[t].table = table;
+        tasks[t].order = order;
+        tasks[t].begin = begin + (int)((long long)(end - begin) * t / threads);
+        tasks[t].end = begin + (int)((long long)(end - begin) * (t + 1) / threads);
+        tasks[t].started = pthread_create(&tasks[t].thread, NULL, statsThread, &tasks[t]) == 0;
+        if (!tasks[t].started) statsThread(&tasks[t]);  // Couldn't start a thread: do its chunk here
     }
+    int result = 0;
+    for (int t = 0; t < threads; t++) {
+        if (tasks[t].started) pthread_join(tasks[t].thread, NULL);
+        if (tasks[t].result != 0 || mergeIssueStats(stats, &tasks[t].stats) != 0) result = -1;
+        freeIssueStats(&tasks[t].stats);
+    }
+    free(tasks);
+    return result;
+}
 
-    // Print the summary header
+// Function to compare groups by key, for qsort
+int compareGroups(const void *a, const void *b) {
+    uint64_t key1 = ((const IssueGroup *)a)->key;
+    uint64_t key2 = ((const IssueGroup *)b)->key;
+    return (key1 > key2) - (key1 < key2);
+}
+
+// Function to list the groups ordered by product, line and issue code (malloc'd, NULL if memory runs out)
+// Only the groups are sorted, never the rows, so this costs next to nothing after the counting pass
+IssueGroup *sortedGroups(const IssueStats *stats) {
+    int n = stats->groups.count;
+    IssueGroup *groups = malloc((n ? n : 1) * sizeof(IssueGroup));
+    if (groups == NULL) return NULL;
+    for (int i = 0; i < n; i++) {
+        groups[i].key = stats->keys[i];
+        groups[i].count = stats->counts[i];
+    }
+    qsort(groups, n, sizeof(IssueGroup), compareGroups);
+    return groups;
+}
+
+// Function to print the issue report of an aggregate: every (product, line, issue code) with its count
+void printIssueReport(const IssueStats *stats) {
+    IssueGroup *groups = sortedGroups(stats);
+    if (groups == NULL) {
+        fprintf(stderr, "Out of memory printing the report\n");
+        return;
+    }
+    printf("Issue Reports by Product ID and Line ID:\n");
+    for (int i = 0; i < stats->groups.count; i++) {
+        uint64_t key = groups[i].key;
+        printf("Product ID: %u, Line ID: %d, Issue Code: %d, Count: %d\n",
+               GROUP_PRODUCT(key), GROUP_LINE(key), GROUP_ISSUE(key), groups[i].count);
+    }
+    printf("\n");
+    free(groups);
+}
+
+// An employee's line of the summary
+typedef struct {
+    const char *name;
+    int count;
+} EmployeeCount;
+
+// Function to compare employees by name, for qsort
+int compareEmployees(const void *a, const void *b) {
+    return strcmp(((const EmployeeCount *)a)->name, ((const EmployeeCount *)b)->name);
+}
+
+// Function to print the number of issues per product of an aggregate, in product ID order, with the
+// earliest one of each, then the number of issues each employee was on
+void printIssueSummary(const IssueStats *stats, const LogTable *table) {
+    IssueGroup *groups = sortedGroups(stats);
+    if (groups == NULL) {
+        fprintf(stderr, "Out of memory printing the summary\n");
+        return;
+    }
     printf("Issue Summary by Product ID:\n");
+    // A product's groups are next to each other once sorted, so their counts add up in one pass
+    for (int i = 0; i < stats->groups.count; ) {
+        uint32_t product_id = GROUP_PRODUCT(groups[i].key);
+        int count = 0;
+        for (; i < stats->groups.count && GROUP_PRODUCT(groups[i].key) == product_id; i++) count += groups[i].count;
+        uint32_t t = findSpan(&stats->products, product_id)->earliest_time;
+        printf("Product ID: %u, Number of Issues: %d, Earliest: %02d/%02d/%02d %02d:%02d\n", product_id, count,
+               TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t));
+    }
+    printf("\n");
+    free(groups);
 
-    // Print the summary
-    for (int i = 0; i < MAX_PRODUCTS; i++) {
-        printf("Product ID: %d, Number of Issues: %d\n", i + 1, issue_count[i]);
+    // Employees by name: IDs depend on the order logs were loaded in, names don't
+    EmployeeCount *employees = malloc((stats->num_employees ? stats->num_employees : 1) * sizeof(EmployeeCount));
+    if (employees == NULL) {
+        fprintf(stderr, "Out of memory printing the summary\n");
+        return;
+    }
+    int num_employees = 0;
+    for (int e = 0; e < stats->num_employees; e++) {
+        if (stats->employee_counts[e] == 0) continue;
+        employees[num_employees].name = table->pool + table->names[e];
+        employees[num_employees].count = stats->employee_counts[e];
+        num_employees++;
+    }
+    qsort(employees, num_employees, sizeof(EmployeeCount), compareEmployees);
+    printf("Issue Summary by Employee:\n");
+    for (int e = 0; e < num_employees; e++) {
+        printf("Employee: %s, Number of Issues: %d\n", employees[e].name, employees[e].count);
     }
     printf("\n");
+    free(employees);
+}
+
+// Function to report issue codes by product ID and line ID, sorted by product, line and issue code
+void reportIssues(LogTable *table) {
+    IssueStats stats;
+    double start = nowSeconds();
+    if (buildIssueStatsParallel(table, NULL, 0, table->num_logs, &stats) != 0) {
+        fprintf(stderr, "Out of memory counting issues\n");
+    } else {
+        if (show_timing) {
+            fprintf(stderr, "Aggregated %d logs on %d thread(s) in %.1f ms\n",
+                    table->num_logs, num_threads, (nowSeconds() - start) * 1e3);
+        }
+        printIssueReport(&stats);
+    }
+    freeIssueStats(&stats);
+}
+
+// Function to find the earliest occurrence of an issue code for a given product ID across all lines
+// Returns the row, or -1 if the product has no logs. A lookup in the index kept by appendLog().
+int findEarliestIssue(LogTable *table, int product_id) {
+    const TimeSpan *span = findSpan(&table->by_product, (uint32_t)product_id);
+    return span != NULL ? (int)span->earliest_row : -1;
+}
+
+// Function to find the latest occurrence of an issue code for a given product ID across all lines
+int findLatestIssue(LogTable *table, int product_id) {
+    const TimeSpan *span = findSpan(&table->by_product, (uint32_t)product_id);
+    return span != NULL ? (int)span->latest_row : -1;
+}
+
+// Function to find the earliest and latest row of a product on one line, NULL if there are none
+const TimeSpan *findLineSpan(LogTable *table, int product_id, int line_id) {
+    return findSpan(&table->by_product_line, PRODUCT_LINE_KEY((uint32_t)product_id, line_id));
+}
+
+// Function to find the earliest and latest row of one issue code for a product, NULL if there are none
+const TimeSpan *findIssueSpan(LogTable *table, int product_id, int issue_code) {
+    return findSpan(&table->by_product_issue, PRODUCT_ISSUE_KEY((uint32_t)product_id, issue_code));
+}
+
+// Function to summarize the number of issues reported for each product across all lines
+void summarizeIssues(LogTable *table) {
+    // Sort logs by date & time
+    if (sortLogs(table) != 0) {
+        fprintf(stderr, "Out of memory sorting logs\n");
+        return;
+    }
+    CompactLog *logs = table->rows;
+    int num_logs = table->num_logs;
+    SortKey *order = table->order;
+
+    // Count the issues of each product and print the summary
+    IssueStats stats;
+    if (buildIssueStatsParallel(table, NULL, 0, table->num_logs, &stats) != 0) fprintf(stderr, "Out of memory counting issues\n");
+    else printIssueSummary(&stats, table);
+    freeIssueStats(&stats);
 
     // Print the detailed summary
     printf("Detailed Issue Summary:\n");
     for (int i = 0; i < num_logs; i++) {
-        printf("Product ID: %d, Issue Code: %d, Date: %02d/%02d/%02d, Time: %02d:%02d, Employees: ",
-               logs[i].product_id, logs[i].issue_code, logs[i].day, logs[i].month, logs[i].year, logs[i].hour, logs[i].minute);
-        for (int j = 0; j < MAX_EMPLOYEES; j++) {
-            if (strlen(logs[i].employee[j]) > 0) {
-                printf("%s, ", logs[i].employee[j]);
-            }
+        const CompactLog *log = &logs[order[i].row];
+        uint32_t t = log->timestamp;
+        printf("Product ID: %u, Issue Code: %d, Date: %02d/%02d/%02d, Time: %02d:%02d, Employees: ",
+               log->product_id, log->issue_code, TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t));
+        for (int j = 0; j < log->num_employees; j++) {
+            printf("%s, ", employeeName(table, log, j));
         }
         printf(", Issue Description: %s, Resolution Description: %s\n",
-               logs[i].issue_description, logs[i].resolution_description);
+               table->pool + log->issue_description, table->pool + log->resolution_description);
+    }
+}
+
+// A time-range query: logs with from <= date & time < to and, if a shift is set, a time of day in it.
+// Shift times are packed as hour << 6 | minute (the low bits of a timestamp). A shift that ends before
+// it starts runs past midnight, and one that starts and ends at the same time is the whole day.
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    int shift_start;
+    int shift_end;
+} TimeQuery;
+
+#define DAY_START(t) ((t) >> 11 << 11)  // Timestamp of 00:00 on the same day
+#define NEXT_DAY(t) (DAY_START(t) + (1 << 11))  // Sorts after every time of the day, even past the 31st
+
+// Function to find the first position from begin to end - 1 of a sorted order with a timestamp >= time
+// (end if there is none), by binary search
+int lowerBound(const SortKey *order, int begin, int end, uint32_t time) {
+    while (begin < end) {
+        int middle = begin + (end - begin) / 2;
+        if (order[middle].timestamp < time) begin = middle + 1;
+        else end = middle;
+    }
+    return begin;
+}
+
+// Function to add the logs at positions begin to end - 1 of the sorted order to an aggregate
+// Returns 0 on success (-1 if memory runs out)
+int addSlice(const LogTable *table, int begin, int end, IssueStats *stats) {
+    if (num_threads <= 1 || end - begin < 2 * 4096) return buildIssueStats(table, table->order, begin, end, stats);
+    // Big enough to split: count it on the threads, then add that to what the earlier slices counted
+    IssueStats slice;
+    int result = buildIssueStatsParallel(table, table->order, begin, end, &slice);
+    if (result == 0) result = mergeIssueStats(stats, &slice);
+    freeIssueStats(&slice);
+    return result;
+}
+
+// Function to aggregate the logs matching a query, returns the number of them (-1 if memory runs out)
+// Binary searches on the sorted order find where the matching logs start and end, so the work grows with
+// the number of matches and days, not the size of the table: one slice for a plain range, or the
+// shift's one or two slices of each day that has logs
+int queryIssues(LogTable *table, const TimeQuery *query, IssueStats *stats) {
+    if (initIssueStats(stats, table) != 0 || sortLogs(table) != 0) return -1;
+    const SortKey *order = table->order;
+    int begin = lowerBound(order, 0, table->num_logs, query->from);
+    int end = lowerBound(order, begin, table->num_logs, query->to);
+    if (query->shift_start == query->shift_end) {
+        return addSlice(table, begin, end, stats) == 0 ? end - begin : -1;
+    }
+
+    int count = 0;
+    for (int pos = begin; pos < end; ) {
+        uint32_t day = DAY_START(order[pos].timestamp);
+        // The shift's part of this day, or the morning and evening ends of one that runs past midnight
+        uint32_t starts[2] = {day | query->shift_start, NEXT_DAY(day)};
+        uint32_t ends[2] = {day | query->shift_end, NEXT_DAY(day)};
+        if (query->shift_start > query->shift_end) {
+            starts[0] = day;
+            starts[1] = day | query->shift_start;
+        }
+        for (int part = 0; part < 2; part++) {
+            int first = lowerBound(order, pos, end, starts[part]);
+            int last = lowerBound(order, first, end, ends[part]);
+            if (addSlice(table, first, last, stats) != 0) return -1;
+            count += last - first;
+        }
+        pos = lowerBound(order, pos, end, NEXT_DAY(day));
+    }
+    return count;
+}
+
+// Function to read an unsigned number at *p and move *p past it (no digits gives -1)
+int parseNumber(const char **p, const char *end) {
+    const char *s = *p;
+    int value = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        value = value * 10 + (*s - '0');
+        s++;
+    }
+    if (s == *p) return -1;
+    *p = s;
+    return value;
+}
+
+// Function to copy text up to the next separator into dest (cut to size - 1 characters) and move *p to the separator
+void parseText(const char **p, const char *end, char sep, char *dest, size_t size) {
+    const char *s = *p;
+    const char *stop = memchr(s, sep, end - s);
+    if (stop == NULL) stop = end;
+    size_t len = stop - s;
+    if (len > size - 1) len = size - 1;
+    memcpy(dest, s, len);
+    dest[len] = '\0';
+    *p = stop;
+}
+
+// Function to step over the separator at *p, returns 0 if it isn't there
+int skipSeparator(const char **p, const char *end, char sep) {
+    if (*p >= end || **p != sep) return 0;
+    (*p)++;
+    return 1;
+}
+
+// Function to parse one log line into entry, returns 0 if the line is well formed
+// Line format (same order as LogEntry):
+//   product_id,line_id,issue_code,day,month,year,hour,minute,employee[;employee...],issue_description,resolution_description
+int parseLogLine(const char *p, const char *end, LogEntry *entry) {
+    int *numbers[] = {&entry->product_id, &entry->line_id, &entry->issue_code, &entry->day,
+                      &entry->month, &entry->year, &entry->hour, &entry->minute};
+    for (int i = 0; i < 8; i++) {
+        *numbers[i] = parseNumber(&p, end);
+        if (*numbers[i] < 0 || !skipSeparator(&p, end, ',')) return -1;
+    }
+
+    // Employees are separated by ';' inside their field
+    const char *field_end = memchr(p, ',', end - p);
+    if (field_end == NULL) return -1;
+    for (int j = 0; j < MAX_EMPLOYEES; j++) {
+        entry->employee[j][0] = '\0';
+        if (p < field_end) {
+            parseText(&p, field_end, ';', entry->employee[j], sizeof(entry->employee[j]));
+            skipSeparator(&p, field_end, ';');
+        }
+    }
+    p = field_end + 1;
+
+    parseText(&p, end, ',', entry->issue_description, sizeof(entry->issue_description));
+    if (!skipSeparator(&p, end, ',')) return -1;
+    parseText(&p, end, ',', entry->resolution_description, sizeof(entry->resolution_description));
+    return 0;
+}
+
+// Function to load monthly log files into the table in a single pass over each file
+// Only logs with from <= timestamp < to are kept. Returns 0 on success, -1 if a file can't be read or memory runs out
+int loadLogs(char **paths, int num_paths, uint32_t from, uint32_t to, LogTable *table) {
+    LogEntry entry;  // Each line is parsed here, then stored in compact form
+    int first = table->num_logs;
+    size_t total_bytes = 0;
+    double start = nowSeconds();
+
+    for (int f = 0; f < num_paths; f++) {
+        int fd = open(paths[f], O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            perror(paths[f]);
+            if (fd >= 0) close(fd);
+            return -1;
+        }
+        if (st.st_size == 0) {
+            close(fd);
+            continue;
+        }
+
+        // The file is read straight from the page cache, never copied into a buffer
+        const char *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            perror(paths[f]);
+            return -1;
+        }
+        madvise((void *)data, st.st_size, MADV_SEQUENTIAL);
+        total_bytes += st.st_size;
+
+        const char *p = data;
+        const char *end = data + st.st_size;
+        int line_number = 0;
+        int failed = 0;
+        while (p < end) {
+            const char *line_end = memchr(p, '\n', end - p);
+            if (line_end == NULL) line_end = end;
+            const char *text_end = line_end;
+            if (text_end > p && text_end[-1] == '\r') text_end--;
+            line_number++;
+
+            // Skip blank lines and '#' comments
+            if (text_end > p && *p != '#') {
+                if (parseLogLine(p, text_end, &entry) != 0) {
+                    fprintf(stderr, "%s:%d: malformed log line skipped\n", paths[f], line_number);
+                } else if (PACK_TIME(entry.year, entry.month, entry.day, entry.hour, entry.minute) >= from &&
+                           PACK_TIME(entry.year, entry.month, entry.day, entry.hour, entry.minute) < to) {
+                    int result = appendLog(table, &entry);
+                    if (result == -2) {
+                        failed = 1;
+                        break;
+                    }
+                    if (result != 0) fprintf(stderr, "%s:%d: date, time or code out of range, log line skipped\n", paths[f], line_number);
+                }
+            }
+            p = line_end + 1;
+        }
+        munmap((void *)data, st.st_size);
+        if (failed) {
+            fprintf(stderr, "Out of memory loading logs\n");
+            return -1;
+        }
+    }
+
+    int count = table->num_logs - first;
+    double seconds = nowSeconds() - start;
+    if (seconds <= 0) seconds = 1e-9;
+    size_t bytes = table->num_logs * sizeof(CompactLog) + table->num_employee_ids * sizeof(uint16_t) + table->pool_size;
+    fprintf(stderr, "Loaded %d logs (%.1f MB) from %d file(s) in %.3f s: %.0f rows/s, %.1f MB/s, %.1f bytes/row in memory\n",
+            count, total_bytes / 1e6, num_paths, seconds, count / seconds, total_bytes / 1e6 / seconds,
+            table->num_logs ? (double)bytes / table->num_logs : 0.0);
+    return 0;
+}
+
+// Columnar file: the logs sorted by time, each field stored as its own array, so a report reads only the
+// columns it needs and a time window only the blocks that overlap it. Blocks are BLOCK_ROWS consecutive
+// rows, and the block index holds the earliest and latest timestamp of each.
+#define COLUMN_MAGIC "QLOGCOL1"
+#define BLOCK_ROWS 4096
+
+// Sections of a columnar file, in file order
+enum {
+    COLUMN_BLOCKS,                  // BlockRange per block
+    COLUMN_TIMESTAMP,               // uint32_t per row
+    COLUMN_PRODUCT,                 // uint32_t per row
+    COLUMN_ISSUE,                   // uint16_t per row
+    COLUMN_LINE,                    // uint8_t per row
+    COLUMN_NUM_EMPLOYEES,           // uint8_t per row
+    COLUMN_EMPLOYEES,               // uint32_t per row: index of the row's first entry in COLUMN_EMPLOYEE_IDS
+    COLUMN_ISSUE_DESCRIPTION,       // uint32_t per row: string number
+    COLUMN_RESOLUTION_DESCRIPTION,  // uint32_t per row: string number
+    COLUMN_EMPLOYEE_IDS,            // uint16_t per employee of each row
+    COLUMN_NAMES,                   // uint32_t per employee ID: string number of the name
+    COLUMN_STRINGS,                 // uint32_t per string: offset in COLUMN_POOL
+    COLUMN_POOL,                    // The strings, NUL-terminated
+    NUM_COLUMNS
+};
+
+// Earliest and latest timestamp of a block
+typedef struct {
+    uint32_t min_time;
+    uint32_t max_time;
+} BlockRange;
+
+// Start of a columnar file
+typedef struct {
+    char magic[8];
+    uint32_t num_logs;
+    uint32_t num_blocks;
+    uint32_t num_names;
+    uint32_t num_strings;
+    uint32_t num_employee_ids;
+    uint32_t block_rows;
+    uint64_t offset[NUM_COLUMNS];   // File offset of each section, 8-byte aligned
+    uint64_t size[NUM_COLUMNS];     // Bytes in each section
+} ColumnHeader;
+
+// An open (memory-mapped) columnar file
+typedef struct {
+    const char *map;
+    size_t size;
+    const ColumnHeader *header;
+} ColumnFile;
+
+// Function to fill scratch with one per-row column of the table in time order, returns its size in bytes
+// Descriptions are written as string numbers, looked up in string_numbers
+size_t fillRowColumn(const LogTable *table, int column, const IdIndex *string_numbers, void *scratch) {
+    int n = table->num_logs;
+    uint32_t *words = scratch;
+    uint16_t *halves = scratch;
+    uint8_t *bytes = scratch;
+    uint32_t next_employee = 0;
+    for (int i = 0; i < n; i++) {
+        const CompactLog *log = &table->rows[table->order[i].row];
+        switch (column) {
+        case COLUMN_TIMESTAMP: words[i] = log->timestamp; break;
+        case COLUMN_PRODUCT: words[i] = log->product_id; break;
+        case COLUMN_ISSUE: halves[i] = log->issue_code; break;
+        case COLUMN_LINE: bytes[i] = log->line_id; break;
+        case COLUMN_NUM_EMPLOYEES: bytes[i] = log->num_employees; break;
+        case COLUMN_EMPLOYEES:
+            words[i] = next_employee;
+            next_employee += log->num_employees;
+            break;
+        case COLUMN_ISSUE_DESCRIPTION: words[i] = findId(string_numbers, log->issue_description); break;
+        case COLUMN_RESOLUTION_DESCRIPTION: words[i] = findId(string_numbers, log->resolution_description); break;
+        }
+    }
+    if (column == COLUMN_ISSUE) return n * sizeof(uint16_t);
+    if (column == COLUMN_LINE || column == COLUMN_NUM_EMPLOYEES) return n * sizeof(uint8_t);
+    return n * sizeof(uint32_t);
+}
+
+// Function to write one section and pad it to 8 bytes, returns 0 on success
+int writeSection(FILE *out, const void *data, size_t size) {
+    static const char padding[8] = {0};
+    size_t pad = (8 - size % 8) % 8;
+    if (size > 0 && fwrite(data, 1, size, out) != size) return -1;
+    if (pad > 0 && fwrite(padding, 1, pad, out) != pad) return -1;
+    return 0;
+}
+
+// Function to save the table as a columnar file, rows in time order. Returns 0 on success
+int writeColumns(LogTable *table, const char *path) {
+    if (sortLogs(table) != 0) return -1;
+    int n = table->num_logs;
+    ColumnHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, COLUMN_MAGIC, sizeof(header.magic));
+    header.num_logs = n;
+    header.num_blocks = (n + BLOCK_ROWS - 1) / BLOCK_ROWS;
+    header.num_names = table->num_names;
+    header.num_employee_ids = table->num_employee_ids;
+    header.block_rows = BLOCK_ROWS;
+
+    // Strings are numbered in pool order, so the reader maps each one once instead of once per row
+    IdIndex string_numbers = {0};
+    uint32_t *strings = NULL;
+    size_t strings_capacity = 0;
+    int failed = 0;
+    for (size_t offset = 0; offset < table->pool_size && !failed; offset += strlen(table->pool + offset) + 1) {
+        failed = insertId(&string_numbers, offset) < 0 ||
+                 growArray((void **)&strings, &strings_capacity, header.num_strings + 1, sizeof(uint32_t)) != 0;
+        if (!failed) strings[header.num_strings++] = offset;
+    }
+    uint32_t *names = malloc((table->num_names ? table->num_names : 1) * sizeof(uint32_t));
+    uint16_t *employee_ids = malloc((table->num_employee_ids ? table->num_employee_ids : 1) * sizeof(uint16_t));
+    BlockRange *blocks = malloc((header.num_blocks ? header.num_blocks : 1) * sizeof(BlockRange));
+    void *scratch = malloc((n ? n : 1) * sizeof(uint32_t));
+    FILE *out = NULL;
+    if (failed || names == NULL || employee_ids == NULL || blocks == NULL || scratch == NULL) {
+        failed = 1;
+        errno = ENOMEM;
+    } else {
+        for (int e = 0; e < table->num_names; e++) names[e] = findId(&string_numbers, table->names[e]);
+        // Each row's employees move next to each other in time order
+        uint32_t next_employee = 0;
+        for (int i = 0; i < n; i++) {
+            const CompactLog *log = &table->rows[table->order[i].row];
+            memcpy(employee_ids + next_employee, table->employee_ids + log->employees, log->num_employees * sizeof(uint16_t));
+            next_employee += log->num_employees;
+        }
+        header.num_employee_ids = next_employee;
+        // Rows are in time order, so a block's first and last rows hold its range
+        for (uint32_t b = 0; b < header.num_blocks; b++) {
+            uint32_t last = (b + 1) * BLOCK_ROWS < (uint32_t)n ? (b + 1) * BLOCK_ROWS - 1 : (uint32_t)n - 1;
+            blocks[b].min_time = table->order[b * BLOCK_ROWS].timestamp;
+            blocks[b].max_time = table->order[last].timestamp;
+        }
+
+        // Section sizes are known up front, so the header goes first with every offset filled in
+        uint64_t sizes[NUM_COLUMNS] = {
+            header.num_blocks * sizeof(BlockRange), n * sizeof(uint32_t), n * sizeof(uint32_t), n * sizeof(uint16_t),
+            n * sizeof(uint8_t), n * sizeof(uint8_t), n * sizeof(uint32_t), n * sizeof(uint32_t), n * sizeof(uint32_t),
+            header.num_employee_ids * sizeof(uint16_t), table->num_names * sizeof(uint32_t),
+            header.num_strings * sizeof(uint32_t), table->pool_size,
+        };
+        uint64_t offset = (sizeof(ColumnHeader) + 7) / 8 * 8;
+        for (int c = 0; c < NUM_COLUMNS; c++) {
+            header.offset[c] = offset;
+            header.size[c] = sizes[c];
+            offset += (sizes[c] + 7) / 8 * 8;
+        }
+
+        out = fopen(path, "wb");
+        failed = out == NULL || writeSection(out, &header, sizeof(header)) != 0 ||
+                 writeSection(out, blocks, sizes[COLUMN_BLOCKS]) != 0;
+        for (int c = COLUMN_TIMESTAMP; c <= COLUMN_RESOLUTION_DESCRIPTION && !failed; c++) {
+            failed = writeSection(out, scratch, fillRowColumn(table, c, &string_numbers, scratch)) != 0;
+        }
+        failed = failed || writeSection(out, employee_ids, sizes[COLUMN_EMPLOYEE_IDS]) != 0 ||
+                 writeSection(out, names, sizes[COLUMN_NAMES]) != 0 ||
+                 writeSection(out, strings, sizes[COLUMN_STRINGS]) != 0 ||
+                 writeSection(out, table->pool, sizes[COLUMN_POOL]) != 0;
+    }
+    if (out != NULL && fclose(out) != 0) failed = 1;
+    if (failed) perror(path);
+    freeIdIndex(&string_numbers);
+    free(strings);
+    free(names);
+    free(employee_ids);
+    free(blocks);
+    free(scratch);
+    return failed ? -1 : 0;
+}
+
+// Function to open a columnar file: maps it and checks that every section lies inside it
+// Returns 0 on success, 1 if the file isn't a columnar file, -1 if it can't be read or is damaged
+int openColumnFile(const char *path, ColumnFile *file) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        perror(path);
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    char magic[8];
+    if (st.st_size < (off_t)sizeof(ColumnHeader) || pread(fd, magic, sizeof(magic), 0) != sizeof(magic) ||
+        memcmp(magic, COLUMN_MAGIC, sizeof(magic)) != 0) {
+        close(fd);
+        return 1;
+    }
+    const char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return -1;
     }
+    file->map = map;
+    file->size = st.st_size;
+    file->header = (const ColumnHeader *)map;
+
+    // Every section must be inside the file and as big as the counts say
+    const ColumnHeader *h = file->header;
+    uint64_t n = h->num_logs;
+    uint64_t expected[NUM_COLUMNS] = {
+        h->num_blocks * sizeof(BlockRange), n * 4, n * 4, n * 2, n, n, n * 4, n * 4, n * 4,
+        h->num_employee_ids * 2ull, h->num_names * 4ull, h->num_strings * 4ull, h->size[COLUMN_POOL],
+    };
+    int valid = h->block_rows > 0 && h->num_blocks == (n + h->block_rows - 1) / h->block_rows;
+    for (int c = 0; c < NUM_COLUMNS && valid; c++) {
+        valid = h->size[c] == expected[c] && h->offset[c] % 8 == 0 && h->offset[c] <= file->size &&
+                h->size[c] <= file->size - h->offset[c];
+    }
+    // The last string must end inside the pool
+    valid = valid && (h->size[COLUMN_POOL] == 0 || map[h->offset[COLUMN_POOL] + h->size[COLUMN_POOL] - 1] == '\0');
+    if (!valid) {
+        fprintf(stderr, "%s: damaged columnar log file\n", path);
+        munmap((void *)map, st.st_size);
+        return -1;
+    }
+    return 0;
+}
+
+// Function to get a section of an open columnar file
+const void *columnData(const ColumnFile *file, int column) {
+    return file->map + file->header->offset[column];
+}
+
+// Function to close a columnar file
+void closeColumnFile(ColumnFile *file) {
+    munmap((void *)file->map, file->size);
+    file->map = NULL;
 }
 
-int main() {
+// Function to add the logs of a columnar file with from <= timestamp < to to the table
+// Blocks whose range misses the window are skipped without reading their rows
+// Returns the number of blocks read, or -1 if memory runs out or the file is damaged
+int loadColumns(const ColumnFile *file, uint32_t from, uint32_t to, LogTable *table) {
+    const ColumnHeader *h = file->header;
+    const BlockRange *blocks = columnData(file, COLUMN_BLOCKS);
+    const uint32_t *timestamps = columnData(file, COLUMN_TIMESTAMP);
+    const uint32_t *products = columnData(file, COLUMN_PRODUCT);
+    const uint16_t *issues = columnData(file, COLUMN_ISSUE);
+    const uint8_t *lines = columnData(file, COLUMN_LINE);
+    const uint8_t *num_employees = columnData(file, COLUMN_NUM_EMPLOYEES);
+    const uint32_t *employees = columnData(file, COLUMN_EMPLOYEES);
+    const uint32_t *issue_descriptions = columnData(file, COLUMN_ISSUE_DESCRIPTION);
+    const uint32_t *resolution_descriptions = columnData(file, COLUMN_RESOLUTION_DESCRIPTION);
+    const uint16_t *employee_ids = columnData(file, COLUMN_EMPLOYEE_IDS);
+    const uint32_t *names = columnData(file, COLUMN_NAMES);
+    const uint32_t *strings = columnData(file, COLUMN_STRINGS);
+    const char *pool = columnData(file, COLUMN_POOL);
+    int was_empty = table->num_logs == 0;
+
+    // The file's strings and employee IDs become the table's once each, rows then only translate numbers
+    uint32_t *string_offsets = malloc((h->num_strings ? h->num_strings : 1) * sizeof(uint32_t));
+    uint16_t *employee_map = malloc((h->num_names ? h->num_names : 1) * sizeof(uint16_t));
+    int result = string_offsets != NULL && employee_map != NULL ? 0 : -1;
+    for (uint32_t k = 0; k < h->num_strings && result == 0; k++) {
+        InternSlot *slot = strings[k] < h->size[COLUMN_POOL] ? internString(table, pool + strings[k]) : NULL;
+        if (slot == NULL) result = -1;
+        else string_offsets[k] = slot->offset - 1;
+    }
+    for (uint32_t e = 0; e < h->num_names && result == 0; e++) {
+        int id = names[e] < h->num_strings ? employeeId(table, table->pool + string_offsets[names[e]]) : -1;
+        if (id < 0) result = -1;
+        else employee_map[e] = id;
+    }
+
+    int blocks_read = 0;
+    int in_order = 1;
+    uint32_t previous = 0;
+    for (uint32_t b = 0; b < h->num_blocks && result == 0; b++) {
+        if (blocks[b].max_time < from || blocks[b].min_time >= to) continue;
+        blocks_read++;
+        uint32_t end = (b + 1) * h->block_rows < h->num_logs ? (b + 1) * h->block_rows : h->num_logs;
+        for (uint32_t i = b * h->block_rows; i < end && result == 0; i++) {
+            if (timestamps[i] < from || timestamps[i] >= to) continue;
+            if (timestamps[i] < previous) in_order = 0;
+            previous = timestamps[i];
+            if (issue_descriptions[i] >= h->num_strings || resolution_descriptions[i] >= h->num_strings ||
+                employees[i] > h->num_employee_ids || num_employees[i] > h->num_employee_ids - employees[i]) {
+                result = -1;
+                break;
+            }
+            CompactLog row;
+            uint16_t ids[256];
+            row.timestamp = timestamps[i];
+            row.product_id = products[i];
+            row.issue_code = issues[i];
+            row.line_id = lines[i];
+            row.num_employees = num_employees[i];
+            row.issue_description = string_offsets[issue_descriptions[i]];
+            row.resolution_description = string_offsets[resolution_descriptions[i]];
+            for (int j = 0; j < row.num_employees; j++) {
+                uint16_t id = employee_ids[employees[i] + j];
+                if (id >= h->num_names) result = -1;
+                else ids[j] = employee_map[id];
+            }
+            if (result == 0 && appendRow(table, &row, ids) != 0) result = -1;
+        }
+    }
+    free(string_offsets);
+    free(employee_map);
+    if (result != 0) return -1;
+
+    // The file is in time order, so a table that was empty is sorted already
+    if (was_empty && in_order) {
+        free(table->order);
+        table->order = malloc((table->num_logs ? table->num_logs : 1) * sizeof(SortKey));
+        if (table->order != NULL) {
+            for (int i = 0; i < table->num_logs; i++) {
+                table->order[i].timestamp = table->rows[i].timestamp;
+                table->order[i].row = i;
+            }
+            table->sorted = 1;
+        }
+    }
+    return blocks_read;
+}
+
+// Function to read a date & time argument, "dd/mm/yy" or "dd/mm/yy-hh:mm", as a packed timestamp
+// Returns 0 on success
+int parseTimeArg(const char *text, uint32_t *time) {
+    const char *p = text;
+    const char *end = text + strlen(text);
+    int day = parseNumber(&p, end);
+    int month = skipSeparator(&p, end, '/') ? parseNumber(&p, end) : -1;
+    int year = skipSeparator(&p, end, '/') ? parseNumber(&p, end) : -1;
+    int hour = 0;
+    int minute = 0;
+    if (skipSeparator(&p, end, '-')) {
+        hour = parseNumber(&p, end);
+        minute = skipSeparator(&p, end, ':') ? parseNumber(&p, end) : -1;
+    }
+    if (p != end || day < 1 || day > 31 || month < 1 || month > 12 || year < 0 || year > 4095 ||
+        hour < 0 || hour > 23 || minute < 0 || minute > 59) {
+        return -1;
+    }
+    *time = PACK_TIME(year, month, day, hour, minute);
+    return 0;
+}
+
+// Function to read a shift argument, "hh:mm-hh:mm", as two packed times of day (the end can be 24:00)
+// Returns 0 on success
+int parseShiftArg(const char *text, int *shift_start, int *shift_end) {
+    const char *p = text;
+    const char *end = text + strlen(text);
+    int times[2];
+    for (int i = 0; i < 2; i++) {
+        if (i == 1 && !skipSeparator(&p, end, '-')) return -1;
+        int hour = parseNumber(&p, end);
+        int minute = skipSeparator(&p, end, ':') ? parseNumber(&p, end) : -1;
+        if (hour < 0 || minute < 0 || minute > 59 || hour > 24 || (hour == 24 && (i == 0 || minute != 0))) return -1;
+        times[i] = hour << 6 | minute;
+    }
+    if (p != end) return -1;
+    *shift_start = times[0];
+    *shift_end = times[1];
+    return 0;
+}
+
+// Function to answer a query: the issue report and summary of the matching logs only
+void reportQuery(LogTable *table, const TimeQuery *query) {
+    IssueStats stats;
+    double start = nowSeconds();
+    int count = queryIssues(table, query, &stats);
+    if (count < 0) {
+        fprintf(stderr, "Out of memory counting issues\n");
+        freeIssueStats(&stats);
+        return;
+    }
+    if (show_timing) fprintf(stderr, "Queried %d of %d logs in %.1f ms\n", count, table->num_logs, (nowSeconds() - start) * 1e3);
+
+    printf("Issues");
+    if (query->from != 0 || query->to != UINT32_MAX) {
+        uint32_t f = query->from;
+        uint32_t t = query->to;
+        printf(" from %02d/%02d/%02d %02d:%02d to %02d/%02d/%02d %02d:%02d",
+               TIME_DAY(f), TIME_MONTH(f), TIME_YEAR(f), TIME_HOUR(f), TIME_MINUTE(f),
+               TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t));
+    }
+    if (query->shift_start != query->shift_end) {
+        printf(" in shift %02d:%02d-%02d:%02d", TIME_HOUR(query->shift_start), TIME_MINUTE(query->shift_start),
+               TIME_HOUR(query->shift_end), TIME_MINUTE(query->shift_end));
+    }
+    printf(": %d logs\n\n", count);
+    printIssueReport(&stats);
+    printIssueSummary(&stats, table);
+    freeIssueStats(&stats);
+}
+
+// Function to load log files of either kind: columnar files through their block index, text files with loadLogs()
+// Returns 0 on success
+int loadFiles(char **paths, int num_paths, uint32_t from, uint32_t to, LogTable *table) {
+    char **text_paths = malloc((num_paths ? num_paths : 1) * sizeof(char *));
+    int num_text = 0;
+    if (text_paths == NULL) return -1;
+    for (int f = 0; f < num_paths; f++) {
+        ColumnFile file;
+        double start = nowSeconds();
+        int kind = openColumnFile(paths[f], &file);
+        if (kind == 1) {
+            text_paths[num_text++] = paths[f];
+            continue;
+        }
+        int before = table->num_logs;
+        int blocks_read = kind == 0 ? loadColumns(&file, from, to, table) : -1;
+        if (kind == 0) {
+            if (blocks_read < 0) fprintf(stderr, "%s: damaged columnar log file or out of memory\n", paths[f]);
+            else fprintf(stderr, "Loaded %d logs from %s, %d of %u blocks read, in %.1f ms\n", table->num_logs - before,
+                         paths[f], blocks_read, file.header->num_blocks, (nowSeconds() - start) * 1e3);
+            closeColumnFile(&file);
+        }
+        if (blocks_read < 0) {
+            free(text_paths);
+            return -1;
+        }
+    }
+    int result = num_text > 0 ? loadLogs(text_paths, num_text, from, to, table) : 0;
+    free(text_paths);
+    return result;
+}
+
+// Function to write a month of made-up logs for one line to stdout, for trying out large inputs
+void generateLogs(int rows, int month, int line_id, int products) {
+    static const char *names[] = {"Max", "Ethan", "Aoife", "Liam", "Niamh", "Sean", "Ciara", "Conor"};
+    static const char *issues[][2] = {
+        {"Leak", "Cap replaced"}, {"Faulty circuit", "Circuit fixed"}, {"Broken seal", "Seal fixed"},
+        {"Label misprint", "Label reprinted"}, {"Underfilled", "Refilled"}, {"Contamination", "Batch quarantined"},
+    };
+    unsigned int seed = month * 31 + line_id;
+    for (int i = 0; i < rows; i++) {
+        seed = seed * 1103515245 + 12345;
+        unsigned int r = seed >> 8;
+        int issue = r % 6;
+        printf("%d,%d,%d,%d,%d,24,%d,%d,%s", 1 + (int)(r % products), line_id, 101 + issue,
+               1 + (int)(r % 28), month, (int)((r >> 5) % 24), (int)((r >> 10) % 60), names[(r >> 16) % 8]);
+        if (r & 1) printf(";%s", names[(r >> 19) % 8]);
+        printf(",%s,%s\n", issues[issue][0], issues[issue][1]);
+    }
+}
+
+// Usage: algo                    runs the tasks on the sample logs below
+//        algo [options] log_file...   runs them on log files: text (one line per entry, see parseLogLine) or columnar
+//          -j threads            aggregate on this many threads
+//          -w from to            only logs with from <= date & time < to, as dd/mm/yy or dd/mm/yy-hh:mm
+//          -c output             don't run the tasks, save the logs as one columnar file
+//          -q from to            don't run the tasks, report on the logs with from <= date & time < to
+//          -s hh:mm-hh:mm        don't run the tasks, report on the logs with a time of day in this shift
+//        algo -g rows month line [products]   writes made-up logs for one line and month to stdout
+int main(int argc, char **argv) {
+    if (argc >= 5 && strcmp(argv[1], "-g") == 0) {
+        generateLogs(atoi(argv[2]), atoi(argv[3]), atoi(argv[4]), argc > 5 ? atoi(argv[5]) : DEFAULT_PRODUCTS);
+        return 0;
+    }
+    int first_file = 1;
+    uint32_t from = 0;
+    uint32_t to = UINT32_MAX;
+    const char *convert_to = NULL;
+    TimeQuery query = {0, UINT32_MAX, 0, 0};
+    int run_query = 0;
+    while (first_file < argc && argv[first_file][0] == '-') {
+        const char *option = argv[first_file];
+        if (strcmp(option, "-j") == 0 && first_file + 1 < argc) {
+            num_threads = atoi(argv[first_file + 1]);
+            if (num_threads < 1) num_threads = 1;
+            first_file += 2;
+        } else if (strcmp(option, "-w") == 0 && first_file + 2 < argc) {
+            if (parseTimeArg(argv[first_file + 1], &from) != 0 || parseTimeArg(argv[first_file + 2], &to) != 0) {
+                printf("Invalid time window. Use dd/mm/yy or dd/mm/yy-hh:mm.\n");
+                return 1;
+            }
+            first_file += 3;
+        } else if (strcmp(option, "-c") == 0 && first_file + 1 < argc) {
+            convert_to = argv[first_file + 1];
+            first_file += 2;
+        } else if (strcmp(option, "-q") == 0 && first_file + 2 < argc) {
+            if (parseTimeArg(argv[first_file + 1], &query.from) != 0 || parseTimeArg(argv[first_file + 2], &query.to) != 0) {
+                printf("Invalid query range. Use dd/mm/yy or dd/mm/yy-hh:mm.\n");
+                return 1;
+            }
+            run_query = 1;
+            first_file += 3;
+        } else if (strcmp(option, "-s") == 0 && first_file + 1 < argc) {
+            if (parseShiftArg(argv[first_file + 1], &query.shift_start, &query.shift_end) != 0) {
+                printf("Invalid shift. Use hh:mm-hh:mm.\n");
+                return 1;
+            }
+            run_query = 1;
+            first_file += 2;
+        } else {
+            printf("Unknown option %s\n", option);
+            return 1;
+        }
+    }
+
     // Sample logs data
-    LogEntry logs[] = {
+    LogEntry sample_logs[] = {
         {1, 1, 101, 1, 4, 24, 12, 30, {"Max"}, "Leak", "Cap replaced"},  // product_id, line_id, issue_code, day, month, year, hour, minute, employee, issue_description, resolution_description
         {2, 2, 102, 2, 4, 24, 10, 15, {"Ethan"}, "Faulty circuit", "Circuit fixed"},
         {3, 3, 103, 3, 4, 24, 8, 45, {"Max"}, "Broken seal", "Seal fixed"},
         {1, 2, 101, 4, 4, 24, 9, 0, {"Ethan"}, "Leak", "Cap tightened"},
         // More log entries can be added as data exapnds
     };
-    int num_logs = sizeof(logs) / sizeof(logs[0]);
+    LogTable table = {0};
+    if (argc > first_file) {
+        if (loadFiles(argv + first_file, argc - first_file, from, to, &table) != 0) return 1;
+        show_timing = 1;
+    } else {
+        for (size_t i = 0; i < sizeof(sample_logs) / sizeof(sample_logs[0]); i++) appendLog(&table, &sample_logs[i]);
+    }
+
+    if (convert_to != NULL) {
+        int result = writeColumns(&table, convert_to);
+        if (result == 0) fprintf(stderr, "Wrote %d logs to %s\n", table.num_logs, convert_to);
+        freeLogTable(&table);
+        return result == 0 ? 0 : 1;
+    }
+    if (run_query) {
+        reportQuery(&table, &query);
+        freeLogTable(&table);
+        return 0;
+    }
 
     // Task 1: Sort the logs by date & time and display
     printf("Task 1: Sort the logs by date & time:\n");
-    sortLogs(logs, num_logs);
-    for (int i = 0; i < num_logs; i++) {
-        printf("Date: %02d/%02d/%02d, Time: %02d:%02d, Product ID: %d, Line ID: %d, Issue Code: %d\n",
-               logs[i].day, logs[i].month, logs[i].year, logs[i].hour, logs[i].minute,
-               logs[i].product_id, logs[i].line_id, logs[i].issue_code);
+    double sort_start = nowSeconds();
+    if (sortLogs(&table) != 0) {
+        fprintf(stderr, "Out of memory sorting logs\n");
+        return 1;
+    }
+    if (show_timing) fprintf(stderr, "Sorted %d logs in %.1f ms\n", table.num_logs, (nowSeconds() - sort_start) * 1e3);
+    for (int i = 0; i < table.num_logs; i++) {
+        const CompactLog *log = &table.rows[table.order[i].row];
+        uint32_t t = log->timestamp;
+        printf("Date: %02d/%02d/%02d, Time: %02d:%02d, Product ID: %u, Line ID: %d, Issue Code: %d\n",
+               TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t),
+               log->product_id, log->line_id, log->issue_code);
     }
     printf("\n");
 
     // Task 2: Report issue codes by product ID and line ID, sorted by line and product ID
     printf("Task 2: Report issue codes by product ID and line ID,:\n");
-    reportIssues(logs, num_logs);
+    reportIssues(&table);
 
     // Task 3: Find the earliest occurrence of an issue code for a given product ID
     int product_id_to_search;
@@ -153,10 +1517,15 @@ int main() {
         printf("Invalid input. Please enter a valid Product ID.\n");
         return 1;
     }
-    int earliest_index = findEarliestIssue(logs, num_logs, product_id_to_search);
+    int earliest_index = findEarliestIssue(&table, product_id_to_search);
     if (earliest_index != -1) {
+        uint32_t t = table.rows[earliest_index].timestamp;
         printf("Earliest occurrence of an issue code for Product ID %d: Issue Code %d at Date: %02d/%02d/%02d Time: %02d:%02d\n",
-               product_id_to_search, logs[earliest_index].issue_code, logs[earliest_index].day, logs[earliest_index].month, logs[earliest_index].year, logs[earliest_index].hour, logs[earliest_index].minute);
+               product_id_to_search, table.rows[earliest_index].issue_code, TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t));
+        int latest_index = findLatestIssue(&table, product_id_to_search);
+        t = table.rows[latest_index].timestamp;
+        printf("Latest occurrence of an issue code for Product ID %d: Issue Code %d at Date: %02d/%02d/%02d Time: %02d:%02d\n",
+               product_id_to_search, table.rows[latest_index].issue_code, TIME_DAY(t), TIME_MONTH(t), TIME_YEAR(t), TIME_HOUR(t), TIME_MINUTE(t));
     } else {
         printf("No issue code found for Product ID %d\n", product_id_to_search);
     }
@@ -164,8 +1533,8 @@ int main() {
 
     // Task 4: Summarize the number of issues reported for each product across all lines
     printf("Task 4: Summarize the number of issues reported for each product across all lines:\n");
-    summarizeIssues(logs, num_logs);
+    summarizeIssues(&table);
 
+    freeLogTable(&table);
     return 0;
 }
-2
@@ -0,0 +1,111 @@
+#!/usr/bin/env bash
+# Benchmarks for myShell: command rate, pipeline throughput, parse speed and cache hit rates.
+# Usage: ./bench.sh [path/to/myShell]     (default: builds shell.c into a temporary directory)
+# Sizes can be changed with RUNS, PIPE_MB, PARSE_LINES and HIST_LINES in the environment.
+#
+# Output is one tab-separated line per measurement, after a header:
+#   bench <TAB> variant <TAB> value <TAB> unit
+# Lines starting with '#' describe the run, so results from two versions can be diffed or joined on
+# the first two columns.
+set -eu
+
+RUNS=${RUNS:-2000}
+PIPE_MB=${PIPE_MB:-256}
+PARSE_LINES=${PARSE_LINES:-20000}
+HIST_LINES=${HIST_LINES:-200000}
+
+here=$(cd "$(dirname "$0")" && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+if [ $# -gt 0 ]; then
+    shell=$1
+else
+    ${CC:-cc} -O2 -o "$tmp/myShell" "$here/shell.c"
+    shell=$tmp/myShell
+fi
+
+now() { date +%s%N; }
+
+# Print one result line
+emit() { printf '%s\t%s\t%s\t%s\n' "$1" "$2" "$3" "$4"; }
+
+# Run a script through the shell with all output discarded, print the elapsed time in ns
+run_timed() {
+    local start
+    start=$(now)
+    HISTFILE=$tmp/history "$shell" "$1" > /dev/null 2>&1
+    echo $(( $(now) - start ))
+}
+
+# Print a / (ns / 1e9), i.e. a per-second rate
+rate() { awk -v a="$1" -v ns="$2" 'BEGIN { printf "%.1f", a / (ns / 1e9) }'; }
+
+echo "# myShell bench $(git -C "$here" rev-parse --short HEAD 2>/dev/null || echo unknown)" \
+     "$(uname -sr) $(date -u +%Y-%m-%dT%H:%M:%SZ)"
+echo "# RUNS=$RUNS PIPE_MB=$PIPE_MB PARSE_LINES=$PARSE_LINES HIST_LINES=$HIST_LINES"
+printf 'bench\tvariant\tvalue\tunit\n'
+
+# Commands per second for "true": the built-in, then /bin/true through each spawn backend
+yes true | head -n "$RUNS" > "$tmp/true_builtin.sh"
+{ echo "spawnmode spawn"; yes /bin/true | head -n "$RUNS"; } > "$tmp/true_spawn.sh"
+{ echo "spawnmode fork"; yes /bin/true | head -n "$RUNS"; } > "$tmp/true_fork.sh"
+for variant in builtin spawn fork; do
+    ns=$(run_timed "$tmp/true_$variant.sh")
+    emit true_rate "$variant" "$(rate "$RUNS" "$ns")" cmds/s
+done
+
+# MB/s through 1-, 2- and 4-stage cat pipelines, with splice() stages and with exec'd cat
+head -c "$((PIPE_MB * 1024 * 1024))" /dev/zero > "$tmp/data"
+for mode in on off; do
+    for stages in 1 2 4; do
+        line="cat $tmp/data"
+        for ((i = 1; i < stages; i++)); do line="$line | cat"; done
+        printf 'fastpipe %s\n%s > /dev/null\n' "$mode" "$line" > "$tmp/pipe.sh"
+        ns=$(run_timed "$tmp/pipe.sh")
+        emit pipe_throughput "cat${stages}_fastpipe_$mode" "$(rate "$PIPE_MB" "$ns")" MB/s
+    done
+done
+
+# Parse throughput: long lines of a built-in, so lexing, parsing and expansion dominate
+awk -v n="$PARSE_LINES" 'BEGIN {
+    for (i = 0; i < n; i++) {
+        line = "true"
+        for (j = 0; j < 100; j++) line = line " arg" j " \"quoted " j "\" x=$HOME"
+        print line
+    }
+}' > "$tmp/parse.sh"
+mb=$(awk -v b="$(wc -c < "$tmp/parse.sh")" 'BEGIN { print b / 1048576 }')
+ns=$(run_timed "$tmp/parse.sh")
+emit parse lines "$(rate "$PARSE_LINES" "$ns")" lines/s
+emit parse bytes "$(rate "$mb" "$ns")" MB/s
+
+# PATH cache: the same few external commands over and over, then the table's own counters
+{ for ((i = 0; i < RUNS / 4; i++)); do echo "ls /"; echo "env"; echo "date"; echo "id"; done; echo "hash -s"; } \
+    > "$tmp/path.sh"
+HISTFILE=$tmp/history "$shell" "$tmp/path.sh" | tail -n 1 > "$tmp/path.out"
+read -r _ hits _ misses _ stale < "$tmp/path.out"
+emit path_cache hits "$hits" count
+emit path_cache misses "$misses" count
+emit path_cache hit_rate "$(awk -v h="$hits" -v m="$misses" 'BEGIN { printf "%.4f", h / (h + m) }')" ratio
+
+# History: a big history file, then listing it (locates every record), a first search (builds the
+# trigram index) and a repeated search (index only). Records are [u32 len][line][u32 len], as the shell writes them.
+# The shell's own "time" keyword does the timing, process startup would drown these out.
+awk -v n="$HIST_LINES" 'BEGIN { for (i = 0; i < n; i++) print "echo history line " i " make test" }' |
+    perl -ne 'chomp; print pack("L", length) . $_ . pack("L", length)' > "$tmp/history"
+{
+    echo 'time history 1 > /dev/null'
+    echo 'time history -s "line 12345 make" > /dev/null'
+} > "$tmp/hist.sh"
+HISTFILE=$tmp/history "$shell" "$tmp/hist.sh" 2>&1 > /dev/null |
+    awk '/^real/ { sub("s$", "", $2); printf "%.3f\n", $2 * 1000 }' > "$tmp/hist.out"
+{ read -r list; read -r first; } < "$tmp/hist.out"
+emit history list_last "$list" ms
+emit history first_search "$first" ms
+# Indexed searches are too quick to time one by one: time a batch against the same script without it
+cp "$tmp/hist.sh" "$tmp/hist_batch.sh"
+yes 'history -s "line 12345 make"' | head -n 1000 >> "$tmp/hist_batch.sh"
+once=$(run_timed "$tmp/hist.sh")
+batch=$(run_timed "$tmp/hist_batch.sh")
+emit history indexed_search "$(awk -v ns="$((batch - once))" 'BEGIN { printf "%.4f", ns / 1000 / 1e6 }')" ms
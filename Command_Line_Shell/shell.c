@@ -1,145 +1,7351 @@
+#define _GNU_SOURCE    // For the Linux extensions used below
+
+
+
 #include <stdio.h>     // For standard input/output functions
 
-#include <stdlib.h>    // For system functions like exit()
+#include <stdlib.h>    // For system functions like exit()
+
+#include <string.h>    // For string manipulation functions like strtok()
+
+#include <unistd.h>    // For system calls like fork(), execv(), and getpid()
+
+#include <sys/wait.h>  // For waitpid() to make the parent wait for child process completion
+
+#include <spawn.h>     // For posix_spawn(), the cheap way to start a child
+
+#include <errno.h>     // For errno values returned by posix_spawn()
+
+#include <time.h>      // For clock_gettime() used by the spawn benchmark
+
+#include <fcntl.h>     // For pipe2(), splice(), tee() and open()
+
+#include <sys/stat.h>  // For fstat() to check whether an fd is a pipe
+
+#include <stdarg.h>    // For the printf-style buffered writer used by built-ins
+
+#include <sys/mman.h>  // For mmap() of script files
+
+#include <signal.h>    // For blocking SIGCHLD and resetting job-control signals in children
+
+#include <sys/signalfd.h>  // For signalfd(), which turns SIGCHLD into something poll() can wait on
+
+#include <poll.h>      // For waiting on the terminal and child exits at the same time
+
+#include <sys/resource.h>  // For wait4() and getrusage(), the resource usage behind "time" and accounting
+
+#include <sys/time.h>  // For timeradd()/timersub() on rusage times
+
+#include <stdint.h>    // For the fixed-size length fields of history records
+
+#include <sys/syscall.h>  // For getdents64(), which glibc doesn't wrap in older versions
+
+#include <dirent.h>    // For the DT_* file types getdents64() reports
+
+#include <sys/epoll.h> // For reading the output pipes of many jobs at once
+
+
+
+extern char **environ;  // Passed to posix_spawn() so children see the shell's environment
+
+
+
+// Define constants for input buffering
+
+#define INPUT_BLOCK (1 << 16)    // Bytes read per read() call when input isn't a terminal
+
+
+
+// Ways of starting an external command
+
+enum spawn_backend {
+
+    SPAWN_POSIX,  // posix_spawn(): vfork-style, the child never copies the shell's page tables
+
+    SPAWN_FORK    // fork() + execv(): slower, but the child can run arbitrary setup code before exec
+
+};
+
+
+
+enum spawn_backend spawn_backend = SPAWN_POSIX;  // Backend used for normal commands
+
+
+
+// A redirection as the child applies it: fd becomes a copy of source, or is closed when source is -1
+
+struct fd_action {
+
+    int fd;
+
+    int source;
+
+};
+
+
+
+// File descriptors a child should get as stdin/stdout, -1 means inherit the shell's
+
+struct child_io {
+
+    int in;
+
+    int out;
+
+    int err;     // stderr, only set when job output is tagged
+
+    pid_t pgid;  // Process group to join: -1 = stay in the shell's, 0 = start a new one
+
+    const struct fd_action *actions;  // Redirections, applied in order after in/out
+
+    int nactions;
+
+};
+
+
+
+int fastpipe = 1;  // Run "cat" and "tee" pipeline stages with splice()/tee() instead of exec
+
+
+
+#define PIPE_CHUNK (1 << 16)  // Bytes moved per splice()/read() call, one full pipe buffer
+
+
+
+int last_status = 0;  // Exit status of the last command, what "exit" with no argument returns
+
+
+
+// Buffered writer for built-in output: a whole built-in's output usually goes out in one write()
+
+// It writes to the built-in's stdout, so redirections apply to it like to any other command
+
+#define WRITER_SIZE (1 << 16)
+
+
+
+struct writer {
+
+    int fd;             // Where the output ends up (stdout, or a pipe when the built-in is a pipeline stage)
+
+    size_t len;         // Bytes waiting in buf
+
+    char buf[WRITER_SIZE];
+
+};
+
+
+
+// Where command lines come from
+
+struct input {
+
+    int interactive;   // Terminal: print a prompt before each line
+
+    int fd;            // Read from this fd, or -1 when the whole input is already in memory
+
+    const char *data;  // Input bytes: the mmap()ed script, the -c string, or the read buffer below
+
+    size_t len;        // Bytes available in data
+
+    size_t pos;        // Start of the next unread line
+
+    char *buf;         // Read buffer for fd input (grows if a single line doesn't fit)
+
+    size_t cap;
+
+};
+
+
+
+// Arena the current line is copied into and parsed in: the line, its command tree and the argument lists
+
+// Allocation just bumps a pointer and everything is released at once before the next line
+
+#define ARENA_ALIGN sizeof(void *)
+
+
+
+struct arena_block {
+
+    struct arena_block *next;  // Older, full blocks
+
+    size_t size;               // Bytes in data
+
+    size_t used;
+
+    char data[];
+
+};
+
+
+
+struct arena {
+
+    struct arena_block *head;  // Block allocations come from
+
+};
+
+
+
+// PATH lookup cache: command name -> absolute path, so repeated commands skip the PATH walk
+
+#define HASH_BUCKETS 256  // Power of two so the bucket is just (hash & (HASH_BUCKETS - 1))
+
+
+
+struct path_entry {
+
+    char *name;               // Command name as typed
+
+    char *path;               // Absolute path it resolved to
+
+    int dir;                  // Index into path_cache.dirs of the directory it was found in
+
+    unsigned long hits;       // Times this entry was used, shown by "hash"
+
+    struct path_entry *next;  // Next entry in the same bucket
+
+};
+
+
+
+struct path_cache {
+
+    char *path_value;         // Value of $PATH the table was built for
+
+    char *dir_buf;            // Copy of $PATH that dirs point into
+
+    char **dirs;              // $PATH split into directories
+
+    struct timespec *mtimes;  // Directory mtimes seen when entries were added
+
+    int ndirs;
+
+    struct path_entry *buckets[HASH_BUCKETS];
+
+    unsigned long hits;       // Lookups answered from the table
+
+    unsigned long misses;     // Lookups that had to walk $PATH
+
+    unsigned long stale;      // Entries dropped because their directory or an earlier one changed
+
+} path_cache;
+
+
+
+// Function to send everything buffered in a writer to its fd
+
+void writer_flush(struct writer *w) {
+
+    size_t off = 0;
+
+    while (off < w->len) {
+
+        ssize_t n = write(w->fd, w->buf + off, w->len - off);
+
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+
+            break;  // Reader went away (e.g. "echo hi | true"), drop the rest
+
+        }
+
+        off += n;
+
+    }
+
+    w->len = 0;
+
+}
+
+
+
+// Function to append bytes to a writer, flushing when the buffer fills
+
+void writer_put(struct writer *w, const char *s, size_t n) {
+
+    while (n > 0) {
+
+        if (w->len == WRITER_SIZE) writer_flush(w);
+
+        size_t room = WRITER_SIZE - w->len;
+
+        size_t chunk = n < room ? n : room;
+
+        memcpy(w->buf + w->len, s, chunk);
+
+        w->len += chunk;
+
+        s += chunk;
+
+        n -= chunk;
+
+    }
+
+}
+
+
+
+// Function to append a string to a writer
+
+void writer_puts(struct writer *w, const char *s) {
+
+    writer_put(w, s, strlen(s));
+
+}
+
+
+
+// Function to printf into a writer
+
+void writer_printf(struct writer *w, const char *fmt, ...) {
+
+    char tmp[1024];
+
+    va_list ap;
+
+    va_start(ap, fmt);
+
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+
+    va_end(ap);
+
+    if (n < 0) return;
+
+    if ((size_t)n < sizeof(tmp)) {
+
+        writer_put(w, tmp, n);
+
+        return;
+
+    }
+
+    // Too long for the stack buffer, format again into the heap
+
+    char *big = malloc(n + 1);
+
+    if (big == NULL) return;
+
+    va_start(ap, fmt);
+
+    vsnprintf(big, n + 1, fmt, ap);
+
+    va_end(ap);
+
+    writer_put(w, big, n);
+
+    free(big);
+
+}
+
+
+
+// Function to get a monotonic timestamp in nanoseconds
+
+long long now_ns(void) {
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+
+}
+
+
+
+// OUTPUT MULTIPLEXER
+
+// With "tagout on", background jobs and parallel tasks write into pipes instead of the terminal.
+
+// The shell reads every pipe through one epoll set and prints whole lines only, each starting with
+
+// the job's tag, so output from many jobs at once never interleaves mid-line.
+
+
+
+#define MUX_LINE_MAX (1 << 16)  // A line longer than this is printed in pieces
+
+
+
+struct mux_stream {
+
+    int fd;                   // Read end of the pipe, -1 once the writers have all gone
+
+    char tag[32];             // Put in front of every line, e.g. "[3] "
+
+    size_t taglen;
+
+    char *partial;            // Start of a line whose newline hasn't arrived yet
+
+    size_t len, cap;
+
+    int owned;                // Freed by its owner (parallel) instead of at end of file
+
+    struct mux_stream *next;
+
+};
+
+
+
+int tag_output = 0;                   // "tagout on"
+
+int mux_epfd = -1;                    // epoll set of all open streams, made on first use
+
+struct mux_stream *mux_list = NULL;   // Open streams, plus closed ones an owner hasn't released
+
+struct writer mux_out = {STDOUT_FILENO, 0, {0}};  // Tagged lines collect here and go out in big writes
+
+
+
+// Function to start a tagged stream, returns the pipe's write end for the job (or -1)
+
+// owned: the caller keeps the stream after end of file and frees it with mux_release()
+
+int mux_open(const char *tag, int owned, struct mux_stream **stream) {
+
+    if (mux_epfd < 0) {
+
+        mux_epfd = epoll_create1(EPOLL_CLOEXEC);
+
+        if (mux_epfd < 0) {
+
+            perror("epoll_create1");
+
+            return -1;
+
+        }
+
+    }
+
+    int fds[2];
+
+    if (pipe2(fds, O_CLOEXEC) < 0) {
+
+        perror("pipe2 failed");
+
+        return -1;
+
+    }
+
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);  // A quiet job must never block the reads of the others
+
+
+
+    struct mux_stream *s = calloc(1, sizeof(struct mux_stream));
+
+    if (s == NULL) {
+
+        perror("myShell");
+
+        close(fds[0]);
+
+        close(fds[1]);
+
+        return -1;
+
+    }
+
+    s->fd = fds[0];
+
+    s->taglen = snprintf(s->tag, sizeof(s->tag), "%s", tag);
+
+    s->owned = owned;
+
+    struct epoll_event ev = {0};
+
+    ev.events = EPOLLIN;
+
+    ev.data.ptr = s;
+
+    epoll_ctl(mux_epfd, EPOLL_CTL_ADD, s->fd, &ev);
+
+    s->next = mux_list;
+
+    mux_list = s;
+
+    if (stream != NULL) *stream = s;
+
+    return fds[1];
+
+}
+
+
+
+// Function to print one finished line (given in up to two pieces) with the stream's tag
+
+void mux_line(struct mux_stream *s, const char *a, size_t alen, const char *b, size_t blen) {
+
+    writer_put(&mux_out, s->tag, s->taglen);
+
+    writer_put(&mux_out, a, alen);
+
+    writer_put(&mux_out, b, blen);
+
+}
+
+
+
+// Function to unlink and free a stream
+
+void mux_free(struct mux_stream *s) {
+
+    for (struct mux_stream **link = &mux_list; *link != NULL; link = &(*link)->next) {
+
+        if (*link == s) {
+
+            *link = s->next;
+
+            break;
+
+        }
+
+    }
+
+    free(s->partial);
+
+    free(s);
+
+}
+
+
+
+// Function to handle a stream's end of file: print what's left of the last line and stop watching it
+
+void mux_close(struct mux_stream *s) {
+
+    if (s->len > 0) mux_line(s, s->partial, s->len, "\n", 1);
+
+    s->len = 0;
+
+    epoll_ctl(mux_epfd, EPOLL_CTL_DEL, s->fd, NULL);
+
+    close(s->fd);
+
+    s->fd = -1;
+
+    if (!s->owned) mux_free(s);
+
+}
+
+
+
+// Function to let go of an owned stream once its job is done (drains it first if still open)
+
+void mux_release(struct mux_stream *s) {
+
+    if (s->fd >= 0) mux_close(s);
+
+    mux_free(s);
+
+    writer_flush(&mux_out);
+
+}
+
+
+
+// Function to read from the streams that have data and print their complete lines
+
+// timeout_ms as for epoll_wait(): 0 just takes what's there now
+
+void mux_drain(int timeout_ms) {
+
+    if (mux_epfd < 0) return;
+
+    struct epoll_event events[64];
+
+    int n = epoll_wait(mux_epfd, events, 64, timeout_ms);
+
+    for (int e = 0; e < n; e++) {
+
+        struct mux_stream *s = events[e].data.ptr;
+
+        // One big read per stream per round: a job that writes nonstop can't starve the others,
+
+        // level-triggered epoll brings it back next round
+
+        static char chunk[PIPE_CHUNK];
+
+        ssize_t got = read(s->fd, chunk, sizeof(chunk));
+
+        if (got < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+
+        if (got <= 0) {
+
+            mux_close(s);
+
+            continue;
+
+        }
+
+        const char *p = chunk;
+
+        const char *end = chunk + got;
+
+        const char *nl;
+
+        while ((nl = memchr(p, '\n', end - p)) != NULL) {
+
+            // Complete line: the held-back start (if any) plus this piece, straight from the read buffer
+
+            mux_line(s, s->partial, s->len, p, nl + 1 - p);
+
+            s->len = 0;
+
+            p = nl + 1;
+
+        }
+
+        if (p < end) {
+
+            size_t rest = end - p;
+
+            if (s->len + rest > s->cap) {
+
+                size_t cap = (s->len + rest) * 2;
+
+                char *partial = realloc(s->partial, cap);
+
+                if (partial == NULL) {
+
+                    // No room to hold it back: print what there is as a line of its own, like an overlong one
+
+                    mux_line(s, s->partial, s->len, p, rest);
+
+                    writer_put(&mux_out, "\n", 1);
+
+                    s->len = 0;
+
+                    continue;
+
+                }
+
+                s->partial = partial;
+
+                s->cap = cap;
+
+            }
+
+            memcpy(s->partial + s->len, p, rest);
+
+            s->len += rest;
+
+            if (s->len >= MUX_LINE_MAX) {
+
+                mux_line(s, s->partial, s->len, "\n", 1);
+
+                s->len = 0;
+
+            }
+
+        }
+
+    }
+
+    writer_flush(&mux_out);
+
+}
+
+
+
+// Function for a forked child that runs shell code: the parent's streams are not its to read
+
+void mux_forget(void) {
+
+    if (mux_epfd >= 0) close(mux_epfd);
+
+    mux_epfd = -1;
+
+    for (struct mux_stream *s = mux_list; s != NULL; s = s->next) {
+
+        if (s->fd >= 0) close(s->fd);
+
+    }
+
+    mux_list = NULL;
+
+}
+
+
+
+// Built-in "tagout": print background and parallel job output as whole lines tagged with the job
+
+// Usage: tagout [on|off]
+
+int builtin_tagout(char **args, struct writer *out) {
+
+    if (args[1] == NULL) {
+
+        writer_printf(out, "%s\n", tag_output ? "on" : "off");
+
+    } else if (strcmp(args[1], "on") == 0 || strcmp(args[1], "off") == 0) {
+
+        tag_output = strcmp(args[1], "on") == 0;
+
+    } else {
+
+        fprintf(stderr, "usage: tagout [on|off]\n");
+
+        return 2;
+
+    }
+
+    return 0;
+
+}
+
+
+
+// JOB CONTROL
+
+// Every pipeline started from the shell is a job, foreground or background
+
+
+
+struct process {
+
+    pid_t pid;
+
+    int done;    // Reaped
+
+    char *name;  // Command name, for the accounting log
+
+};
+
+
+
+enum job_state { JOB_RUNNING, JOB_STOPPED, JOB_DONE };
+
+
+
+struct job {
+
+    int id;                 // Number shown as [id] and used as %id
+
+    pid_t pgid;             // Process group shared by all stages (job control only)
+
+    struct process *procs;  // One per stage that actually started
+
+    int nprocs;
+
+    int remaining;          // Started processes not reaped yet
+
+    pid_t last_pid;         // Last stage, its status is the job's status
+
+    int background;         // Started with '&', or stopped and left in the background
+
+    enum job_state state;
+
+    int status;             // Exit status once the job is done
+
+    char *command;          // Command text for "jobs"
+
+    long long start;        // now_ns() when the job was created
+
+    struct rusage usage;    // Summed over the processes reaped so far, max RSS is the largest one
+
+    struct job *next;
+
+};
+
+
+
+struct job *job_list = NULL;  // Newest job first
+
+int job_control = 0;          // Interactive: jobs get their own process group and the terminal
+
+pid_t shell_pgid;             // The shell's own process group, gets the terminal back after a job
+
+int sigchld_fd = -1;          // signalfd that becomes readable whenever a child exits or stops
+
+
+
+int acct_fd = -1;             // Accounting log, one CSV line per finished command, -1 when off
+
+char *acct_path = NULL;
+
+
+
+// Function to add one process's resource usage to a total
+
+void add_usage(struct rusage *total, const struct rusage *ru) {
+
+    timeradd(&total->ru_utime, &ru->ru_utime, &total->ru_utime);
+
+    timeradd(&total->ru_stime, &ru->ru_stime, &total->ru_stime);
+
+    if (ru->ru_maxrss > total->ru_maxrss) total->ru_maxrss = ru->ru_maxrss;
+
+    total->ru_nvcsw += ru->ru_nvcsw;
+
+    total->ru_nivcsw += ru->ru_nivcsw;
+
+}
+
+
+
+// Function to append one record to the accounting log
+
+// Fields: epoch,status,real,user,sys,maxrss_kb,vcsw,ivcsw,command; the command goes last so it may hold commas
+
+void acct_write(const char *name, int status, long long wall_ns, const struct rusage *ru) {
+
+    if (acct_fd < 0) return;
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_REALTIME, &now);
+
+    char line[512];
+
+    int n = snprintf(line, sizeof(line), "%lld.%03ld,%d,%.6f,%ld.%06ld,%ld.%06ld,%ld,%ld,%ld,%s\n",
+
+                     (long long)now.tv_sec, now.tv_nsec / 1000000, status, wall_ns / 1e9,
+
+                     (long)ru->ru_utime.tv_sec, (long)ru->ru_utime.tv_usec,
+
+                     (long)ru->ru_stime.tv_sec, (long)ru->ru_stime.tv_usec,
+
+                     ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw, name);
+
+    if (n >= (int)sizeof(line)) {
+
+        // Very long command name: cut it, keeping the newline
+
+        n = sizeof(line) - 1;
+
+        line[n - 1] = '\n';
+
+    }
+
+    // One write() per record on an O_APPEND fd: lines from concurrent shells never interleave
+
+    if (write(acct_fd, line, n) != n) perror("acct");
+
+}
+
+
+
+// Function to turn a wait status into a shell exit status (128 + signal for killed children)
+
+int status_code(int wstatus) {
+
+    if (WIFEXITED(wstatus)) return WEXITSTATUS(wstatus);
+
+    if (WIFSIGNALED(wstatus)) return 128 + WTERMSIG(wstatus);
+
+    return 1;
+
+}
+
+
+
+// Function to create a job and put it at the front of the job table
+
+struct job *new_job(const char *command, int background) {
+
+    struct job *j = calloc(1, sizeof(struct job));
+
+    if (j == NULL) {
+
+        perror("myShell");
+
+        exit(1);
+
+    }
+
+    // Next number after the highest one in use, like other shells
+
+    int id = 0;
+
+    for (struct job *o = job_list; o != NULL; o = o->next) {
+
+        if (o->id > id) id = o->id;
+
+    }
+
+    j->id = id + 1;
+
+    j->command = strdup(command);
+
+    j->background = background;
+
+    j->last_pid = -1;
+
+    j->status = 127;  // Stays 127 if the last stage never starts
+
+    j->state = JOB_DONE;  // Becomes running once a process is added
+
+    j->start = now_ns();
+
+    j->next = job_list;
+
+    job_list = j;
+
+    return j;
+
+}
+
+
+
+// Function to record a started process in its job
+
+void job_add_process(struct job *j, pid_t pid, const char *name) {
+
+    const char *slash = strrchr(name, '/');
+
+    j->procs = realloc(j->procs, sizeof(struct process) * (j->nprocs + 1));
+
+    j->procs[j->nprocs].pid = pid;
+
+    j->procs[j->nprocs].done = 0;
+
+    j->procs[j->nprocs].name = strdup(slash != NULL ? slash + 1 : name);
+
+    j->nprocs++;
+
+    j->remaining++;
+
+    j->state = JOB_RUNNING;
+
+    if (job_control && j->pgid == 0) j->pgid = pid;  // First stage leads the process group
+
+}
+
+
+
+// Function to take a job out of the table and free it
+
+void free_job(struct job *j) {
+
+    for (struct job **link = &job_list; *link != NULL; link = &(*link)->next) {
+
+        if (*link == j) {
+
+            *link = j->next;
+
+            break;
+
+        }
+
+    }
+
+    for (int p = 0; p < j->nprocs; p++) free(j->procs[p].name);
+
+    free(j->procs);
+
+    free(j->command);
+
+    free(j);
+
+}
+
+
+
+// Function to record a state change reported by wait4() against the job it belongs to
+
+void mark_process(pid_t pid, int wstatus, const struct rusage *ru) {
+
+    for (struct job *j = job_list; j != NULL; j = j->next) {
+
+        for (int p = 0; p < j->nprocs; p++) {
+
+            if (j->procs[p].pid != pid) continue;
+
+            if (WIFSTOPPED(wstatus)) {
+
+                j->state = JOB_STOPPED;
+
+                return;
+
+            }
+
+            j->procs[p].done = 1;
+
+            j->remaining--;
+
+            add_usage(&j->usage, ru);
+
+            acct_write(j->procs[p].name, status_code(wstatus), now_ns() - j->start, ru);
+
+            if (pid == j->last_pid) j->status = status_code(wstatus);
+
+            if (j->remaining == 0) j->state = JOB_DONE;
+
+            return;
+
+        }
+
+    }
+
+    // Not one of ours (e.g. a spawnbench child), nothing to update
+
+}
+
+
+
+// Function to reap every child that has changed state, without blocking
+
+void reap_children(void) {
+
+    // Empty the signalfd first so it only becomes readable again for new events
+
+    struct signalfd_siginfo info;
+
+    while (sigchld_fd >= 0 && read(sigchld_fd, &info, sizeof(info)) == sizeof(info)) {
+
+    }
+
+    // wait4() rather than waitpid(): it hands back the child's resource usage for free
+
+    int wstatus;
+
+    pid_t pid;
+
+    struct rusage ru;
+
+    while ((pid = wait4(-1, &wstatus, WNOHANG | WUNTRACED, &ru)) > 0) {
+
+        mark_process(pid, wstatus, &ru);
+
+    }
+
+}
+
+
+
+// Function to block until a job finishes or stops, driven by SIGCHLD through the signalfd
+
+// foreground: hand the job the terminal while it runs (job control only)
+
+int wait_for_job(struct job *j, int foreground) {
+
+    if (foreground && job_control && j->pgid > 0) tcsetpgrp(STDIN_FILENO, j->pgid);
+
+    while (1) {
+
+        reap_children();
+
+        if (j->state != JOB_RUNNING) break;
+
+        if (sigchld_fd < 0) {
+
+            // No signalfd: plain blocking wait for the next child event
+
+            int wstatus;
+
+            struct rusage ru;
+
+            pid_t pid = wait4(-1, &wstatus, WUNTRACED, &ru);
+
+            if (pid > 0) mark_process(pid, wstatus, &ru);
+
+            else if (errno != EINTR) break;
+
+            continue;
+
+        }
+
+        // Tagged output of background jobs keeps flowing while we wait
+
+        struct pollfd fds[2] = {{sigchld_fd, POLLIN, 0}, {mux_epfd, POLLIN, 0}};
+
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+
+            perror("poll failed");
+
+            break;
+
+        }
+
+        if (fds[1].revents & POLLIN) mux_drain(0);
+
+    }
+
+    if (foreground && job_control) tcsetpgrp(STDIN_FILENO, shell_pgid);
+
+
+
+    int status = j->status;
+
+    if (j->state == JOB_STOPPED) {
+
+        // Ctrl-Z: keep it in the table so fg/bg can pick it up again
+
+        j->background = 1;
+
+        fprintf(stderr, "\n[%d]+  Stopped\t%s\n", j->id, j->command);
+
+        status = 148;  // 128 + SIGTSTP, like other shells
+
+    }
+
+    return status;
+
+}
+
+
+
+// Function to print and drop background jobs that have finished, returns how many were reported
+
+int report_jobs(int verbose) {
+
+    int reported = 0;
+
+    struct job *j = job_list;
+
+    while (j != NULL) {
+
+        struct job *next = j->next;
+
+        if (j->background && j->state == JOB_DONE) {
+
+            if (verbose) {
+
+                if (j->status == 0) printf("[%d]   Done\t\t%s\n", j->id, j->command);
+
+                else printf("[%d]   Exit %d\t\t%s\n", j->id, j->status, j->command);
+
+                reported++;
+
+            }
+
+            free_job(j);
+
+        }
+
+        j = next;
+
+    }
+
+    if (reported) fflush(stdout);
+
+    return reported;
+
+}
+
+
+
+// Function to take over the terminal when running interactively
+
+void init_job_control(void) {
+
+    // If we were started in the background, wait until we are brought to the foreground
+
+    while (tcgetpgrp(STDIN_FILENO) != (shell_pgid = getpgrp())) {
+
+        kill(-shell_pgid, SIGTTIN);
+
+    }
+
+    // The shell itself must survive Ctrl-C/Ctrl-Z, and not get stopped for using the terminal
+
+    signal(SIGINT, SIG_IGN);
+
+    signal(SIGQUIT, SIG_IGN);
+
+    signal(SIGTSTP, SIG_IGN);
+
+    signal(SIGTTIN, SIG_IGN);
+
+    signal(SIGTTOU, SIG_IGN);
+
+    // Own process group, so the terminal can be handed to jobs and back
+
+    setpgid(0, 0);
+
+    shell_pgid = getpid();
+
+    tcsetpgrp(STDIN_FILENO, shell_pgid);
+
+    job_control = 1;
+
+}
+
+
+
+// Function to display the prompt
+
+void print_prompt(void) {
+
+    printf("myShell> ");  // Display shell prompt
+
+    fflush(stdout);       // Built-ins write straight to fd 1, so the prompt must be out first
+
+}
+
+
+
+// Function to get n bytes from the arena
+
+// A full block is never moved or grown, so pointers into the arena stay valid until the reset
+
+void *arena_alloc(struct arena *a, size_t n) {
+
+    n = (n + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    struct arena_block *b = a->head;
+
+    if (b == NULL || b->size - b->used < n) {
+
+        size_t size = b ? b->size * 2 : 4096;
+
+        while (size < n) size *= 2;
+
+        b = malloc(sizeof(struct arena_block) + size);
+
+        if (b == NULL) {
+
+            perror("myShell");
+
+            exit(1);
+
+        }
+
+        b->next = a->head;
+
+        b->size = size;
+
+        b->used = 0;
+
+        a->head = b;
+
+    }
+
+    void *p = b->data + b->used;
+
+    b->used += n;
+
+    return p;
+
+}
+
+
+
+// Function to release everything in the arena
+
+// If the last line needed several blocks they become one block that size, so the next such line needs none
+
+void arena_reset(struct arena *a) {
+
+    struct arena_block *b = a->head;
+
+    if (b == NULL) return;
+
+    if (b->next != NULL) {
+
+        size_t total = 0;
+
+        while (b != NULL) {
+
+            struct arena_block *next = b->next;
+
+            total += b->size;
+
+            free(b);
+
+            b = next;
+
+        }
+
+        a->head = NULL;
+
+        arena_alloc(a, total);
+
+        b = a->head;
+
+    }
+
+    b->used = 0;
+
+}
+
+
+
+// Function to give the arena's memory back to malloc
+
+void arena_free(struct arena *a) {
+
+    while (a->head != NULL) {
+
+        struct arena_block *next = a->head->next;
+
+        free(a->head);
+
+        a->head = next;
+
+    }
+
+}
+
+
+
+// Function to copy a line into the arena as a NUL-terminated string
+
+char *arena_store(struct arena *a, const char *line, size_t len) {
+
+    char *copy = arena_alloc(a, len + 1);
+
+    memcpy(copy, line, len);
+
+    copy[len] = '\0';
+
+    return copy;
+
+}
+
+
+
+// Function to read more input from the fd into the read buffer, returns bytes read (0 at end of input)
+
+ssize_t fill_input(struct input *in) {
+
+    // Slide the unread tail to the front so the buffer never grows just from old lines
+
+    size_t left = in->len - in->pos;
+
+    memmove(in->buf, in->buf + in->pos, left);
+
+    in->len = left;
+
+    in->pos = 0;
+
+    if (in->cap - in->len < INPUT_BLOCK) {
+
+        // The current line is longer than what's free, make room for another full block
+
+        size_t cap = in->cap ? in->cap * 2 : INPUT_BLOCK * 2;
+
+        char *buf = realloc(in->buf, cap);
+
+        if (buf == NULL) {
+
+            perror("myShell");
+
+            exit(1);
+
+        }
+
+        in->buf = buf;
+
+        in->cap = cap;
+
+    }
+
+    in->data = in->buf;
+
+
+
+    // Interactive: wait for typing and for child exits together, so finished jobs are reported right away
+
+    while (in->interactive && sigchld_fd >= 0) {
+
+        struct pollfd fds[3] = {{in->fd, POLLIN, 0}, {sigchld_fd, POLLIN, 0}, {mux_epfd, POLLIN, 0}};
+
+        if (poll(fds, 3, -1) < 0) {
+
+            if (errno == EINTR) continue;
+
+            break;
+
+        }
+
+        if (fds[2].revents & POLLIN) {
+
+            mux_drain(0);
+
+            print_prompt();
+
+        }
+
+        if (fds[1].revents & POLLIN) {
+
+            reap_children();
+
+            if (report_jobs(1)) print_prompt();
+
+        }
+
+        if (fds[0].revents) break;
+
+    }
+
+
+
+    ssize_t n;
+
+    do {
+
+        n = read(in->fd, in->buf + in->len, in->cap - in->len);
+
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+
+        perror("Error reading command");
+
+        return 0;
+
+    }
+
+    in->len += n;
+
+    return n;
+
+}
+
+
+
+// Function to get the next line of input into the arena, NULL at end of input
+
+// Lines can be any length, a terminal gives one line per read() and a file gives many
+
+char *next_line(struct input *in, struct arena *a) {
+
+    while (1) {
+
+        const char *start = in->data + in->pos;
+
+        const char *nl = memchr(start, '\n', in->len - in->pos);
+
+        if (nl != NULL) {
+
+            in->pos += (nl - start) + 1;
+
+            return arena_store(a, start, nl - start);
+
+        }
+
+        // No full line left: get more input, or hand back the unterminated last line
+
+        if (in->fd < 0 || fill_input(in) == 0) {
+
+            if (in->pos == in->len) return NULL;
+
+            size_t len = in->len - in->pos;
+
+            start = in->data + in->pos;
+
+            in->pos = in->len;
+
+            return arena_store(a, start, len);
+
+        }
+
+    }
+
+}
+
+
+
+// Function to read the next command line, NULL at end of input
+
+// Whatever the previous line left in the arena is released first
+
+char *read_command(struct input *in, struct arena *a) {
+
+    arena_reset(a);
+
+    // Pick up background jobs that finished while the last command ran, and what they printed
+
+    mux_drain(0);
+
+    reap_children();
+
+    report_jobs(in->interactive);
+
+    if (in->interactive) print_prompt();
+
+    return next_line(in, a);
+
+}
+
+
+
+// Function to set up script input: mmap() the file so lines are found in place, no copying reads
+
+int open_script(struct input *in, const char *path) {
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+
+        fprintf(stderr, "myShell: %s: %s\n", path, strerror(errno));
+
+        return -1;
+
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+
+        if (st.st_size == 0) {
+
+            close(fd);
+
+            in->fd = -1;
+
+            in->data = "";
+
+            return 0;
+
+        }
+
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (map != MAP_FAILED) {
+
+            madvise(map, st.st_size, MADV_SEQUENTIAL);  // Read-ahead, we go through it once front to back
+
+            close(fd);
+
+            in->fd = -1;
+
+            in->data = map;
+
+            in->len = st.st_size;
+
+            return 0;
+
+        }
+
+    }
+
+    // Not a regular file (e.g. a fifo), read it in big blocks instead
+
+    in->fd = fd;
+
+    return 0;
+
+}
+
+
+
+
+
+// HISTORY
+
+// Interactive lines are appended to a log file that is mmap()ed, never parsed, when the shell starts.
+
+// Each record is [u32 length][line][u32 length] written with one write() on an O_APPEND fd,
+
+// so several shells can share the file. Records are located and indexed lazily, on first use.
+
+
+
+// Posting list of one trigram: the records containing it, in increasing order
+
+struct trigram_list {
+
+    uint32_t key;   // The three bytes plus one, 0 marks an empty slot
+
+    uint32_t n, cap;
+
+    uint32_t *ids;
+
+};
+
+
+
+struct history {
+
+    int fd;
+
+    const char *map;       // File contents
+
+    size_t mapped;         // Bytes mapped
+
+    uint64_t *offsets;     // File offset of each record located so far
+
+    uint32_t count, cap;
+
+    size_t scanned;        // File offset up to which records have been located
+
+    struct trigram_list *index;  // Open-addressing table from trigram to posting list
+
+    size_t index_cap;      // Slots, a power of two
+
+    size_t index_used;
+
+    uint32_t indexed;      // Records already added to the index
+
+} history = {-1, NULL, 0, NULL, 0, 0, 0, NULL, 0, 0, 0};
+
+
+
+// Function to open (creating if needed) the history file: $HISTFILE, or ~/.myshell_history
+
+// Only the mapping is set up, so this costs the same for ten entries or ten million
+
+void history_open(void) {
+
+    const char *path = getenv("HISTFILE");
+
+    char buf[4096];
+
+    if (path == NULL) {
+
+        const char *home = getenv("HOME");
+
+        snprintf(buf, sizeof(buf), "%s/.myshell_history", home != NULL ? home : ".");
+
+        path = buf;
+
+    }
+
+    history.fd = open(path, O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+    if (history.fd < 0) fprintf(stderr, "myShell: %s: %s\n", path, strerror(errno));
+
+}
+
+
+
+// Function to extend the mapping to the current end of the file, which other shells may have moved
+
+int history_remap(void) {
+
+    struct stat st;
+
+    if (history.fd < 0 || fstat(history.fd, &st) != 0) return -1;
+
+    size_t size = st.st_size;
+
+    if (size <= history.mapped) return 0;
+
+    void *map = history.map == NULL
+
+        ? mmap(NULL, size, PROT_READ, MAP_SHARED, history.fd, 0)
+
+        : mremap((void *)history.map, history.mapped, size, MREMAP_MAYMOVE);
+
+    if (map == MAP_FAILED) {
+
+        perror("history");
+
+        return -1;
+
+    }
+
+    history.map = map;
+
+    history.mapped = size;
+
+    return 0;
+
+}
+
+
+
+// Function to append a line to the history file as one framed record
+
+void history_add(const char *line) {
+
+    if (history.fd < 0) return;
+
+    const char *p = line;
+
+    while (*p == ' ' || *p == '\t') p++;
+
+    if (*p == '\0') return;  // Blank lines aren't worth keeping
+
+
+
+    uint32_t len = strlen(line);
+
+    char *record = malloc(len + 2 * sizeof(uint32_t));
+
+    if (record == NULL) return;
+
+    memcpy(record, &len, sizeof(len));
+
+    memcpy(record + sizeof(len), line, len);
+
+    memcpy(record + sizeof(len) + len, &len, sizeof(len));
+
+    // A single write() to an O_APPEND fd lands whole at the end, even with other shells appending
+
+    ssize_t size = len + 2 * sizeof(uint32_t);
+
+    if (write(history.fd, record, size) != size) perror("history");
+
+    free(record);
+
+}
+
+
+
+// Function to locate the records added since the last call, returns the number of records
+
+// Stops at a record that isn't complete yet (another shell mid-write) and picks it up next time
+
+uint32_t history_scan(void) {
+
+    history_remap();
+
+    while (history.scanned + 2 * sizeof(uint32_t) <= history.mapped) {
+
+        uint32_t len, trailer;
+
+        memcpy(&len, history.map + history.scanned, sizeof(len));
+
+        size_t end = history.scanned + sizeof(len) + (size_t)len;
+
+        if (end + sizeof(trailer) > history.mapped) break;
+
+        memcpy(&trailer, history.map + end, sizeof(trailer));
+
+        if (trailer != len) break;  // Damaged framing: keep what was before it
+
+        if (history.count == history.cap) {
+
+            history.cap = history.cap ? history.cap * 2 : 1024;
+
+            history.offsets = realloc(history.offsets, history.cap * sizeof(uint64_t));
+
+        }
+
+        history.offsets[history.count++] = history.scanned;
+
+        history.scanned = end + sizeof(trailer);
+
+    }
+
+    return history.count;
+
+}
+
+
+
+// Function to get record id's text and length (not NUL-terminated, it points into the mapping)
+
+const char *history_entry(uint32_t id, uint32_t *len) {
+
+    memcpy(len, history.map + history.offsets[id], sizeof(*len));
+
+    return history.map + history.offsets[id] + sizeof(*len);
+
+}
+
+
+
+// Function to find the posting list slot for a trigram key (empty slot if it isn't in the table)
+
+struct trigram_list *trigram_slot(uint32_t key) {
+
+    size_t mask = history.index_cap - 1;
+
+    size_t i = (key * 2654435761u) & mask;
+
+    while (history.index[i].key != 0 && history.index[i].key != key) i = (i + 1) & mask;
+
+    return &history.index[i];
+
+}
+
+
+
+// Function to double the trigram table, rehashing the posting lists into it
+
+void trigram_grow(void) {
+
+    struct trigram_list *old = history.index;
+
+    size_t old_cap = history.index_cap;
+
+    history.index_cap = old_cap ? old_cap * 2 : 4096;
+
+    history.index = calloc(history.index_cap, sizeof(struct trigram_list));
+
+    for (size_t i = 0; i < old_cap; i++) {
+
+        if (old[i].key != 0) *trigram_slot(old[i].key) = old[i];
+
+    }
+
+    free(old);
+
+}
+
+
+
+// Function to pack three bytes into a trigram key
+
+uint32_t trigram_key(const char *s) {
+
+    return (((uint32_t)(unsigned char)s[0] << 16) | ((uint32_t)(unsigned char)s[1] << 8) |
+
+            (uint32_t)(unsigned char)s[2]) + 1;
+
+}
+
+
+
+// Function to bring the trigram index up to date: only records added since the last search are indexed
+
+void history_index(void) {
+
+    history_scan();
+
+    for (; history.indexed < history.count; history.indexed++) {
+
+        uint32_t id = history.indexed;
+
+        uint32_t len;
+
+        const char *text = history_entry(id, &len);
+
+        for (uint32_t i = 0; i + 3 <= len; i++) {
+
+            if (history.index_used * 10 >= history.index_cap * 7) trigram_grow();  // Keep the load under 70%
+
+            uint32_t key = trigram_key(text + i);
+
+            struct trigram_list *l = trigram_slot(key);
+
+            if (l->key == 0) {
+
+                l->key = key;
+
+                history.index_used++;
+
+            }
+
+            if (l->n > 0 && l->ids[l->n - 1] == id) continue;  // Trigram repeats within this record
+
+            if (l->n == l->cap) {
+
+                l->cap = l->cap ? l->cap * 2 : 4;
+
+                l->ids = realloc(l->ids, l->cap * sizeof(uint32_t));
+
+            }
+
+            l->ids[l->n++] = id;
+
+        }
+
+    }
+
+}
+
+
+
+// Built-in "history": list or search past command lines
+
+// Usage: history [n]         the last n lines (default: all of them)
+
+//        history -s text     lines containing text, newest first
+
+int builtin_history(char **args, struct writer *out) {
+
+    if (history.fd < 0) history_open();
+
+    if (history.fd < 0) return 1;
+
+
+
+    if (args[1] != NULL && strcmp(args[1], "-s") == 0) {
+
+        if (args[2] == NULL) {
+
+            fprintf(stderr, "usage: history [n] | history -s text\n");
+
+            return 2;
+
+        }
+
+        const char *needle = args[2];
+
+        size_t nlen = strlen(needle);
+
+        uint32_t len;
+
+
+
+        if (nlen < 3) {
+
+            // Too short for a trigram: check every record, newest first
+
+            for (uint32_t id = history_scan(); id-- > 0; ) {
+
+                const char *text = history_entry(id, &len);
+
+                if (memmem(text, len, needle, nlen) != NULL) writer_printf(out, "%6u  %.*s\n", id + 1, (int)len, text);
+
+            }
+
+            return 0;
+
+        }
+
+
+
+        // Candidates come from the rarest trigram of the search text, then each is checked for real
+
+        history_index();
+
+        if (history.index_cap == 0) return 1;
+
+        struct trigram_list *best = NULL;
+
+        for (size_t i = 0; i + 3 <= nlen; i++) {
+
+            struct trigram_list *l = trigram_slot(trigram_key(needle + i));
+
+            if (l->key == 0) return 1;  // A trigram no record has: no matches
+
+            if (best == NULL || l->n < best->n) best = l;
+
+        }
+
+        int found = 0;
+
+        for (uint32_t k = best->n; k-- > 0; ) {
+
+            uint32_t id = best->ids[k];
+
+            const char *text = history_entry(id, &len);
+
+            if (memmem(text, len, needle, nlen) == NULL) continue;
+
+            writer_printf(out, "%6u  %.*s\n", id + 1, (int)len, text);
+
+            found = 1;
+
+        }
+
+        return found ? 0 : 1;
+
+    }
+
+
+
+    uint32_t count = history_scan();
+
+    uint32_t first = 0;
+
+    if (args[1] != NULL) {
+
+        long n = atol(args[1]);
+
+        if (n >= 0 && (uint32_t)n < count) first = count - n;
+
+    }
+
+    for (uint32_t id = first; id < count; id++) {
+
+        uint32_t len;
+
+        const char *text = history_entry(id, &len);
+
+        writer_printf(out, "%6u  %.*s\n", id + 1, (int)len, text);
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Lexer and parser: one pass over the line, no copying
+
+// Tokens are slices of the line in the arena and the command tree is built in the same arena.
+
+// Quotes stay in the words until they are expanded, right before the command runs.
+
+
+
+enum token_type {
+
+    TOK_WORD,
+
+    TOK_PIPE,    // |
+
+    TOK_AND_IF,  // &&
+
+    TOK_OR_IF,   // ||
+
+    TOK_AMP,     // &
+
+    TOK_SEMI,    // ;
+
+    TOK_REDIR,   // Any redirection operator, which one is in token.redir
+
+    TOK_END,     // End of the line, or a comment
+
+    TOK_ERROR    // Unterminated quote
+
+};
+
+
+
+enum redir_type {
+
+    REDIR_IN,      // [n]<  file
+
+    REDIR_OUT,     // [n]>  file
+
+    REDIR_APPEND,  // [n]>> file
+
+    REDIR_DUP,     // [n]>&m or [n]<&m, "-" as m closes n
+
+    REDIR_STRING   // [n]<<< word, the word and a newline are fed to the command
+
+};
+
+
+
+struct token {
+
+    enum token_type type;
+
+    const char *text;       // Where the token starts in the line
+
+    size_t len;
+
+    enum redir_type redir;  // TOK_REDIR only
+
+    int fd;                 // TOK_REDIR only: the fd being redirected
+
+};
+
+
+
+// A word exactly as typed, quotes and backslashes still in it
+
+struct word {
+
+    const char *text;
+
+    size_t len;
+
+};
+
+
+
+struct redirect {
+
+    enum redir_type type;
+
+    int fd;
+
+    struct word target;     // File name, fd number or here-string
+
+    struct redirect *next;  // Applied in the order they were written
+
+};
+
+
+
+// One simple command, e.g. "sort -n < data"
+
+struct command {
+
+    struct word *words;
+
+    int nwords;
+
+    struct redirect *redirs;
+
+    struct command *next;   // Next stage of the pipeline
+
+};
+
+
+
+// How a pipeline is joined to the one before it
+
+enum connector {
+
+    CONNECT_NONE,  // First pipeline of the list
+
+    CONNECT_AND,   // &&
+
+    CONNECT_OR     // ||
+
+};
+
+
+
+// Commands joined by "|"
+
+struct pipeline {
+
+    struct command *stages;
+
+    int nstages;
+
+    int timed;  // Started with the "time" keyword
+
+    char *text; // Source text, the job's name in the job table
+
+    enum connector connector;
+
+    struct pipeline *next;
+
+};
+
+
+
+// Pipelines joined by "&&" and "||", ended by ";", "&" or the end of the line
+
+struct and_or {
+
+    struct pipeline *pipelines;
+
+    int background;      // Ended by "&"
+
+    char *text;          // Source text, the job's name in the job table
+
+    struct and_or *next;
+
+};
+
+
+
+struct parser {
+
+    const char *pos;      // Lexer position in the line
+
+    struct token tok;     // Current token
+
+    struct arena *arena;  // Where the tree goes
+
+};
+
+
+
+// Function to check whether an unquoted character ends a word
+
+int is_word_end(char c) {
+
+    return c == '\0' || c == ' ' || c == '\t' || c == '\r' ||
+
+           c == '|' || c == '&' || c == ';' || c == '<' || c == '>';
+
+}
+
+
+
+// Function to read the next token of the line, moving *pos past it
+
+void next_token(const char **pos, struct token *t) {
+
+    const char *p = *pos;
+
+    while (*p == ' ' || *p == '\t' || *p == '\r') p++;
+
+    t->text = p;
+
+
+
+    // A '#' at the start of a word comments out the rest of the line
+
+    if (*p == '\0' || *p == '#') {
+
+        t->type = TOK_END;
+
+        t->len = 0;
+
+        *pos = p;
+
+        return;
+
+    }
+
+
+
+    // Digits right before '<' or '>' name the fd to redirect ("2>errors")
+
+    const char *digits = p;
+
+    while (*digits >= '0' && *digits <= '9') digits++;
+
+    int fd = -1;
+
+    if (digits > p && digits - p < 10 && (*digits == '<' || *digits == '>')) {
+
+        fd = atoi(p);
+
+        p = digits;
+
+    }
+
+
+
+    t->type = TOK_REDIR;
+
+    if (p[0] == '<' && p[1] == '<' && p[2] == '<') {
+
+        t->redir = REDIR_STRING;
+
+        p += 3;
+
+    } else if (p[0] == '<' && p[1] == '&') {
+
+        t->redir = REDIR_DUP;
+
+        p += 2;
+
+    } else if (p[0] == '<') {
+
+        t->redir = REDIR_IN;
+
+        p += 1;
+
+    } else if (p[0] == '>' && p[1] == '>') {
+
+        t->redir = REDIR_APPEND;
+
+        p += 2;
+
+    } else if (p[0] == '>' && p[1] == '&') {
+
+        t->redir = REDIR_DUP;
+
+        p += 2;
+
+    } else if (p[0] == '>') {
+
+        t->redir = REDIR_OUT;
+
+        p += 1;
+
+    } else if (p[0] == '|') {
+
+        t->type = p[1] == '|' ? TOK_OR_IF : TOK_PIPE;
+
+        p += p[1] == '|' ? 2 : 1;
+
+    } else if (p[0] == '&') {
+
+        t->type = p[1] == '&' ? TOK_AND_IF : TOK_AMP;
+
+        p += p[1] == '&' ? 2 : 1;
+
+    } else if (p[0] == ';') {
+
+        t->type = TOK_SEMI;
+
+        p += 1;
+
+    } else {
+
+        // A word runs to the first unquoted blank or operator character
+
+        t->type = TOK_WORD;
+
+        while (!is_word_end(*p)) {
+
+            if (*p == '\\') {
+
+                p++;
+
+                if (*p != '\0') p++;
+
+            } else if (*p == '\'') {
+
+                const char *close = strchr(p + 1, '\'');
+
+                if (close == NULL) {
+
+                    t->type = TOK_ERROR;
+
+                    break;
+
+                }
+
+                p = close + 1;
+
+            } else if (*p == '"') {
+
+                p++;
+
+                while (*p != '\0' && *p != '"') {
+
+                    if (*p == '\\' && p[1] != '\0') p++;
+
+                    p++;
+
+                }
+
+                if (*p == '\0') {
+
+                    t->type = TOK_ERROR;
+
+                    break;
+
+                }
+
+                p++;
+
+            } else {
+
+                p++;
+
+            }
+
+        }
+
+    }
+
+    if (t->type == TOK_REDIR && fd < 0) fd = (*t->text == '<') ? 0 : 1;  // Input operators default to stdin
+
+    t->fd = fd;
+
+    t->len = p - t->text;
+
+    *pos = p;
+
+}
+
+
+
+// Function to move the parser to the next token
+
+void parser_advance(struct parser *ps) {
+
+    next_token(&ps->pos, &ps->tok);
+
+}
+
+
+
+// Function to report a syntax error at the parser's current token
+
+void syntax_error(const struct token *t) {
+
+    if (t->type == TOK_ERROR) fprintf(stderr, "myShell: syntax error: unterminated quote\n");
+
+    else if (t->type == TOK_END) fprintf(stderr, "myShell: syntax error: unexpected end of line\n");
+
+    else fprintf(stderr, "myShell: syntax error near '%.*s'\n", (int)t->len, t->text);
+
+}
+
+
+
+// Function to parse a simple command: words and redirections in any order, NULL on a syntax error
+
+struct command *parse_simple_command(struct parser *ps) {
+
+    // Words collect here and move into the arena in one piece once the count is known
+
+    // Kept between calls, so a command costs no allocation per word
+
+    static struct word *words;
+
+    static size_t cap;
+
+    size_t nwords = 0;
+
+    struct redirect *redirs = NULL;
+
+    struct redirect **tail = &redirs;
+
+
+
+    while (1) {
+
+        if (ps->tok.type == TOK_WORD) {
+
+            if (nwords == cap) {
+
+                cap = cap ? cap * 2 : 32;
+
+                words = realloc(words, cap * sizeof(struct word));
+
+                if (words == NULL) {
+
+                    perror("myShell");
+
+                    exit(1);
+
+                }
+
+            }
+
+            words[nwords].text = ps->tok.text;
+
+            words[nwords].len = ps->tok.len;
+
+            nwords++;
+
+        } else if (ps->tok.type == TOK_REDIR) {
+
+            struct redirect *r = arena_alloc(ps->arena, sizeof(struct redirect));
+
+            r->type = ps->tok.redir;
+
+            r->fd = ps->tok.fd;
+
+            r->next = NULL;
+
+            parser_advance(ps);
+
+            if (ps->tok.type != TOK_WORD) {
+
+                syntax_error(&ps->tok);
+
+                return NULL;
+
+            }
+
+            r->target.text = ps->tok.text;
+
+            r->target.len = ps->tok.len;
+
+            *tail = r;
+
+            tail = &r->next;
+
+        } else {
+
+            break;
+
+        }
+
+        parser_advance(ps);
+
+    }
+
+    if (nwords == 0 && redirs == NULL) {
+
+        syntax_error(&ps->tok);
+
+        return NULL;
+
+    }
+
+
+
+    struct command *c = arena_alloc(ps->arena, sizeof(struct command));
+
+    c->words = arena_alloc(ps->arena, nwords * sizeof(struct word));
+
+    memcpy(c->words, words, nwords * sizeof(struct word));
+
+    c->nwords = nwords;
+
+    c->redirs = redirs;
+
+    c->next = NULL;
+
+    return c;
+
+}
+
+
+
+// Function to copy the source text from start up to the current token into the arena, without trailing blanks
+
+char *source_text(struct parser *ps, const char *start) {
+
+    const char *end = ps->tok.text;
+
+    while (end > start && (end[-1] == ' ' || end[-1] == '\t')) end--;
+
+    return arena_store(ps->arena, start, end - start);
+
+}
+
+
+
+// Function to parse commands joined by "|", NULL on a syntax error
+
+struct pipeline *parse_pipeline(struct parser *ps) {
+
+    const char *start = ps->tok.text;
+
+    struct pipeline *p = arena_alloc(ps->arena, sizeof(struct pipeline));
+
+    p->connector = CONNECT_NONE;
+
+    p->next = NULL;
+
+    p->nstages = 0;
+
+    p->timed = 0;
+
+    // "time" is a keyword, not a command: it covers the whole pipeline, built-ins included
+
+    if (ps->tok.type == TOK_WORD && ps->tok.len == 4 && strncmp(ps->tok.text, "time", 4) == 0) {
+
+        p->timed = 1;
+
+        parser_advance(ps);
+
+    }
+
+    struct command **tail = &p->stages;
+
+    while (1) {
+
+        struct command *c = parse_simple_command(ps);
+
+        if (c == NULL) return NULL;
+
+        *tail = c;
+
+        tail = &c->next;
+
+        p->nstages++;
+
+        if (ps->tok.type != TOK_PIPE) break;
+
+        parser_advance(ps);
+
+    }
+
+    p->text = source_text(ps, start);
+
+    return p;
+
+}
+
+
+
+// Function to parse pipelines joined by "&&" and "||", NULL on a syntax error
+
+struct pipeline *parse_and_or(struct parser *ps) {
+
+    struct pipeline *first = NULL;
+
+    struct pipeline **tail = &first;
+
+    enum connector connector = CONNECT_NONE;
+
+    while (1) {
+
+        struct pipeline *p = parse_pipeline(ps);
+
+        if (p == NULL) return NULL;
+
+        p->connector = connector;
+
+        *tail = p;
+
+        tail = &p->next;
+
+        if (ps->tok.type == TOK_AND_IF) connector = CONNECT_AND;
+
+        else if (ps->tok.type == TOK_OR_IF) connector = CONNECT_OR;
+
+        else break;
+
+        parser_advance(ps);
+
+    }
+
+    return first;
+
+}
+
+
+
+// Function to parse a whole line into a list of and-or lists separated by ";" and "&"
+
+// Returns NULL for an empty line, or after printing a syntax error (last_status is then 2)
+
+struct and_or *parse_command(const char *line, struct arena *a) {
+
+    struct parser ps = {line, {0}, a};
+
+    struct and_or *list = NULL;
+
+    struct and_or **tail = &list;
+
+    parser_advance(&ps);
+
+    while (ps.tok.type != TOK_END) {
+
+        const char *start = ps.tok.text;
+
+        struct and_or *item = arena_alloc(a, sizeof(struct and_or));
+
+        item->pipelines = parse_and_or(&ps);
+
+        if (item->pipelines == NULL) {
+
+            last_status = 2;
+
+            return NULL;
+
+        }
+
+        item->text = source_text(&ps, start);
+
+        item->background = ps.tok.type == TOK_AMP;
+
+        item->next = NULL;
+
+        if (ps.tok.type == TOK_AMP || ps.tok.type == TOK_SEMI) {
+
+            parser_advance(&ps);
+
+        } else if (ps.tok.type != TOK_END) {
+
+            syntax_error(&ps.tok);
+
+            last_status = 2;
+
+            return NULL;
+
+        }
+
+        *tail = item;
+
+        tail = &item->next;
+
+    }
+
+    return list;
+
+}
+
+
+
+// EXPANSION
+
+// After parsing, each word has $VAR/${VAR}/$?/$$ and a leading ~ replaced and its quotes removed.
+
+// Unquoted *, ? and [...] then make it a glob pattern, matched against directory listings
+
+// that are read with getdents64() at most once per command line.
+
+
+
+// Growable byte buffer for building expanded words, reused for every word
+
+struct strbuf {
+
+    char *data;
+
+    size_t len, cap;
+
+};
+
+
+
+// Function to append bytes to a buffer
+
+void strbuf_put(struct strbuf *b, const char *s, size_t n) {
+
+    if (b->len + n + 1 > b->cap) {
+
+        b->cap = (b->len + n + 1) * 2;
+
+        b->data = realloc(b->data, b->cap);
+
+        if (b->data == NULL) {
+
+            perror("myShell");
+
+            exit(1);
+
+        }
+
+    }
+
+    memcpy(b->data + b->len, s, n);
+
+    b->len += n;
+
+    b->data[b->len] = '\0';
+
+}
+
+
+
+// Function to look up a variable by a name that isn't NUL-terminated, NULL if unset
+
+// $? and $$ are the shell's own, everything else comes from the environment
+
+const char *lookup_var(const char *name, size_t len) {
+
+    static char number[24];
+
+    if (len == 1 && name[0] == '?') {
+
+        snprintf(number, sizeof(number), "%d", last_status);
+
+        return number;
+
+    }
+
+    if (len == 1 && name[0] == '$') {
+
+        snprintf(number, sizeof(number), "%d", (int)getpid());
+
+        return number;
+
+    }
+
+    for (char **env = environ; *env != NULL; env++) {
+
+        if (strncmp(*env, name, len) == 0 && (*env)[len] == '=') return *env + len + 1;
+
+    }
+
+    return NULL;
+
+}
+
+
+
+// Function to check whether c can be part of a variable name
+
+int is_name_char(char c) {
+
+    return c == '_' || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+
+}
+
+
+
+// Function to expand a "$..." at p, appending the value to text and pattern
+
+// Returns the number of characters of the word that were used up
+
+size_t expand_dollar(const char *p, const char *end, int quoted, struct strbuf *text, struct strbuf *pattern) {
+
+    const char *name = p + 1;
+
+    size_t len = 0;
+
+    size_t used;
+
+    if (name < end && (*name == '?' || *name == '$')) {
+
+        len = 1;
+
+        used = 2;
+
+    } else if (name < end && *name == '{') {
+
+        name++;
+
+        // Inside double quotes the brace has to close before the quote does
+
+        while (name + len < end && name[len] != '}' && !(quoted && name[len] == '"')) len++;
+
+        if (name + len == end || name[len] != '}') {
+
+            // No closing brace: not an expansion, keep the text
+
+            if (quoted) {
+
+                // Only the '$', the rest is quoted text the caller copies up to the '"'
+
+                strbuf_put(text, "$", 1);
+
+                strbuf_put(pattern, "$", 1);
+
+                return 1;
+
+            }
+
+            strbuf_put(text, p, end - p);
+
+            strbuf_put(pattern, p, end - p);
+
+            return end - p;
+
+        }
+
+        used = len + 3;
+
+    } else {
+
+        while (name + len < end && is_name_char(name[len])) len++;
+
+        used = len + 1;
+
+    }
+
+    if (len == 0) {
+
+        // A lone '$' stays as it is
+
+        strbuf_put(text, "$", 1);
+
+        strbuf_put(pattern, "$", 1);
+
+        return 1;
+
+    }
+
+
+
+    const char *value = lookup_var(name, len);
+
+    if (value == NULL) return used;
+
+    strbuf_put(text, value, strlen(value));
+
+    // Unquoted values may glob like typed text; quoted ones have their glob characters escaped
+
+    for (const char *v = value; *v != '\0'; v++) {
+
+        if (quoted && (*v == '*' || *v == '?' || *v == '[' || *v == '\\')) strbuf_put(pattern, "\\", 1);
+
+        strbuf_put(pattern, v, 1);
+
+    }
+
+    return used;
+
+}
+
+
+
+// Function to expand variables and remove quotes from a word
+
+// text gets the final word. pattern gets the same word with quoted glob characters backslash-escaped.
+
+// Returns 1 when an unquoted glob character makes the word a pattern. *had_quotes says whether any quoting was seen.
+
+int expand_text(const struct word *w, struct strbuf *text, struct strbuf *pattern, int *had_quotes) {
+
+    const char *p = w->text;
+
+    const char *end = w->text + w->len;
+
+    int glob = 0;
+
+    text->len = 0;
+
+    pattern->len = 0;
+
+    strbuf_put(text, "", 0);
+
+    strbuf_put(pattern, "", 0);
+
+    *had_quotes = 0;
+
+
+
+    // A leading unquoted ~ is $HOME
+
+    if (p < end && *p == '~' && (p + 1 == end || p[1] == '/')) {
+
+        const char *home = getenv("HOME");
+
+        if (home != NULL) {
+
+            strbuf_put(text, home, strlen(home));
+
+            strbuf_put(pattern, home, strlen(home));
+
+            p++;
+
+        }
+
+    }
+
+
+
+    while (p < end) {
+
+        if (*p == '\'') {
+
+            // Single quotes: everything up to the closing quote is literal
+
+            *had_quotes = 1;
+
+            for (p++; p < end && *p != '\''; p++) {
+
+                if (*p == '*' || *p == '?' || *p == '[' || *p == '\\') strbuf_put(pattern, "\\", 1);
+
+                strbuf_put(text, p, 1);
+
+                strbuf_put(pattern, p, 1);
+
+            }
+
+            if (p < end) p++;
+
+        } else if (*p == '"') {
+
+            // Double quotes: variables still expand, a backslash only escapes \ " $ and `
+
+            *had_quotes = 1;
+
+            p++;
+
+            while (p < end && *p != '"') {
+
+                if (*p == '$') {
+
+                    p += expand_dollar(p, end, 1, text, pattern);
+
+                    continue;
+
+                }
+
+                if (*p == '\\' && p + 1 < end && strchr("\\\"$`", p[1]) != NULL) p++;
+
+                if (*p == '*' || *p == '?' || *p == '[' || *p == '\\') strbuf_put(pattern, "\\", 1);
+
+                strbuf_put(text, p, 1);
+
+                strbuf_put(pattern, p, 1);
+
+                p++;
+
+            }
+
+            if (p < end) p++;
+
+        } else if (*p == '\\' && p + 1 < end) {
+
+            *had_quotes = 1;
+
+            strbuf_put(text, p + 1, 1);
+
+            strbuf_put(pattern, p, 2);  // The escape is kept, it means the same to the matcher
+
+            p += 2;
+
+        } else if (*p == '$') {
+
+            size_t before = pattern->len;
+
+            p += expand_dollar(p, end, 0, text, pattern);
+
+            if (strpbrk(pattern->data + before, "*?[") != NULL) glob = 1;
+
+        } else {
+
+            // A '[' only starts a pattern if a ']' follows, so "[ -f x ]" costs no directory read
+
+            if (*p == '*' || *p == '?' || (*p == '[' && memchr(p + 1, ']', end - p - 1) != NULL)) glob = 1;
+
+            strbuf_put(text, p, 1);
+
+            strbuf_put(pattern, p, 1);
+
+            p++;
+
+        }
+
+    }
+
+    return glob;
+
+}
+
+
+
+// Function to expand a word into its final text, for redirection targets (no globbing)
+
+char *expand_word(const struct word *w, struct arena *a) {
+
+    static struct strbuf text, pattern;
+
+    int had_quotes;
+
+    expand_text(w, &text, &pattern, &had_quotes);
+
+    return arena_store(a, text.data, text.len);
+
+}
+
+
+
+// One step of a compiled glob pattern
+
+enum glob_op { GLOB_CHAR, GLOB_ANY, GLOB_SET, GLOB_STAR };
+
+
+
+struct glob_step {
+
+    enum glob_op op;
+
+    unsigned char c;         // GLOB_CHAR
+
+    unsigned char set[32];   // GLOB_SET: bitmap of the bytes that match
+
+};
+
+
+
+// Function to compile one path component of a pattern into steps, returns the step count
+
+// Classes are turned into bitmaps here, so matching never re-reads the pattern text
+
+int glob_compile(const char *pat, size_t len, struct glob_step *steps) {
+
+    int n = 0;
+
+    size_t i = 0;
+
+    while (i < len) {
+
+        struct glob_step *st = &steps[n];
+
+        char c = pat[i];
+
+        if (c == '*') {
+
+            i++;
+
+            if (n > 0 && steps[n - 1].op == GLOB_STAR) continue;  // "**" is the same as "*"
+
+            st->op = GLOB_STAR;
+
+        } else if (c == '?') {
+
+            st->op = GLOB_ANY;
+
+            i++;
+
+        } else if (c == '[') {
+
+            // Find the closing bracket; a ']' right after "[" or "[!" is part of the set
+
+            size_t j = i + 1;
+
+            int negate = j < len && (pat[j] == '!' || pat[j] == '^');
+
+            if (negate) j++;
+
+            size_t first = j;
+
+            if (j < len && pat[j] == ']') j++;
+
+            while (j < len && pat[j] != ']') j++;
+
+            if (j >= len) {
+
+                // No closing bracket: a literal '['
+
+                st->op = GLOB_CHAR;
+
+                st->c = '[';
+
+                i++;
+
+                n++;
+
+                continue;
+
+            }
+
+            st->op = GLOB_SET;
+
+            memset(st->set, 0, sizeof(st->set));
+
+            for (size_t k = first; k < j; k++) {
+
+                unsigned char lo = pat[k], hi = pat[k];
+
+                if (lo == '\\' && k + 1 < j) lo = hi = pat[++k];
+
+                if (k + 2 < j && pat[k + 1] == '-') {
+
+                    hi = pat[k + 2];
+
+                    k += 2;
+
+                }
+
+                for (unsigned int b = lo; b <= hi; b++) st->set[b >> 3] |= 1 << (b & 7);
+
+            }
+
+            if (negate) {
+
+                for (int b = 0; b < 32; b++) st->set[b] = ~st->set[b];
+
+            }
+
+            i = j + 1;
+
+        } else {
+
+            if (c == '\\' && i + 1 < len) c = pat[++i];
+
+            st->op = GLOB_CHAR;
+
+            st->c = c;
+
+            i++;
+
+        }
+
+        n++;
+
+    }
+
+    return n;
+
+}
+
+
+
+// Function to check whether one step matches a byte
+
+int glob_step_matches(const struct glob_step *st, unsigned char c) {
+
+    if (st->op == GLOB_ANY) return 1;
+
+    if (st->op == GLOB_CHAR) return st->c == c;
+
+    return (st->set[c >> 3] >> (c & 7)) & 1;
+
+}
+
+
+
+// Function to match a name against compiled steps
+
+// No recursion: a mismatch only goes back to the most recent '*', retrying it one byte longer.
+
+// Earlier stars never need revisiting, so the cost is bounded by name length times pattern length.
+
+int glob_match(const struct glob_step *steps, int nsteps, const char *name) {
+
+    size_t len = strlen(name);
+
+    int si = 0;
+
+    size_t ni = 0;
+
+    int star_si = -1;     // Step index of the last '*' seen
+
+    size_t star_ni = 0;   // Where in the name that '*' resumes matching
+
+    while (si < nsteps || ni < len) {
+
+        if (si < nsteps) {
+
+            const struct glob_step *st = &steps[si];
+
+            if (st->op == GLOB_STAR) {
+
+                star_si = si;
+
+                star_ni = ni + 1;
+
+                si++;
+
+                continue;
+
+            }
+
+            if (ni < len && glob_step_matches(st, name[ni])) {
+
+                si++;
+
+                ni++;
+
+                continue;
+
+            }
+
+        }
+
+        if (star_si >= 0 && star_ni <= len) {
+
+            si = star_si;
+
+            ni = star_ni;
+
+            continue;
+
+        }
+
+        return 0;
+
+    }
+
+    return 1;
+
+}
+
+
+
+// A directory listing as getdents64() returned it, kept in the line's arena
+
+struct linux_dirent64 {
+
+    uint64_t d_ino;
+
+    int64_t d_off;
+
+    unsigned short d_reclen;
+
+    unsigned char d_type;
+
+    char d_name[];
+
+};
+
+
+
+struct dir_chunk {
+
+    char *data;  // Raw getdents64() records
+
+    size_t len;
+
+    struct dir_chunk *next;
+
+};
+
+
+
+struct dir_listing {
+
+    char *path;              // As used in the pattern, "" for the current directory
+
+    struct dir_chunk *chunks;
+
+    struct dir_listing *next;
+
+};
+
+
+
+struct dir_listing *dir_cache = NULL;  // Directories read for the current line, reset before each line
+
+
+
+// Function to get a directory's entries, reading it only the first time in this command line
+
+// NULL if it can't be opened
+
+struct dir_listing *read_dir(const char *path, struct arena *a) {
+
+    for (struct dir_listing *d = dir_cache; d != NULL; d = d->next) {
+
+        if (strcmp(d->path, path) == 0) return d;
+
+    }
+
+    int fd = open(path[0] != '\0' ? path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd < 0) return NULL;
+
+    struct dir_listing *d = arena_alloc(a, sizeof(struct dir_listing));
+
+    d->path = arena_store(a, path, strlen(path));
+
+    d->chunks = NULL;
+
+    struct dir_chunk **tail = &d->chunks;
+
+    // Bulk reads: one syscall returns as many entries as fit in the buffer
+
+    static char buf[1 << 16];
+
+    long n;
+
+    while ((n = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0) {
+
+        struct dir_chunk *c = arena_alloc(a, sizeof(struct dir_chunk));
+
+        c->data = arena_alloc(a, n);
+
+        memcpy(c->data, buf, n);
+
+        c->len = n;
+
+        c->next = NULL;
+
+        *tail = c;
+
+        tail = &c->next;
+
+    }
+
+    close(fd);
+
+    d->next = dir_cache;
+
+    dir_cache = d;
+
+    return d;
+
+}
+
+
+
+// Function to compare two strings for qsort()
+
+int compare_strings(const void *a, const void *b) {
+
+    return strcmp(*(char *const *)a, *(char *const *)b);
+
+}
+
+
+
+// Function to find the paths matching a pattern, one '/'-separated component at a time
+
+// Matches are added to fields (a malloc()ed array) in sorted order; returns how many were added
+
+int glob_expand(const char *pattern, struct arena *a, char ***fields, int *nfields, int *cap) {
+
+    // Paths matched so far, each ending in '/' (or empty: the current directory)
+
+    char **paths = malloc(sizeof(char *));
+
+    int npaths = 1;
+
+    paths[0] = pattern[0] == '/' ? "/" : "";
+
+    const char *comp = pattern;
+
+    while (*comp == '/') comp++;
+
+    struct glob_step *steps = malloc(sizeof(struct glob_step) * (strlen(pattern) + 1));
+
+
+
+    while (*comp != '\0' && npaths > 0) {
+
+        const char *slash = strchr(comp, '/');
+
+        size_t clen = slash != NULL ? (size_t)(slash - comp) : strlen(comp);
+
+        int last = slash == NULL || slash[strspn(slash, "/")] == '\0';
+
+        int dirs_only = slash != NULL;  // A '/' follows, even a trailing one: only directories match
+
+        int nsteps = glob_compile(comp, clen, steps);
+
+        int literal = 1;
+
+        for (int s = 0; s < nsteps; s++) {
+
+            if (steps[s].op != GLOB_CHAR) literal = 0;
+
+        }
+
+
+
+        char **next = NULL;
+
+        int nnext = 0, next_cap = 0;
+
+        for (int p = 0; p < npaths; p++) {
+
+            size_t plen = strlen(paths[p]);
+
+            if (literal) {
+
+                // Nothing to match: just append the component, existence is checked at the end
+
+                char *path = arena_alloc(a, plen + nsteps + 2);
+
+                memcpy(path, paths[p], plen);
+
+                for (int s = 0; s < nsteps; s++) path[plen + s] = steps[s].c;
+
+                strcpy(path + plen + nsteps, last ? "" : "/");
+
+                if (nnext == next_cap) {
+
+                    next_cap = next_cap ? next_cap * 2 : 16;
+
+                    next = realloc(next, next_cap * sizeof(char *));
+
+                }
+
+                next[nnext++] = path;
+
+                continue;
+
+            }
+
+            struct dir_listing *d = read_dir(paths[p], a);
+
+            if (d == NULL) continue;
+
+            for (struct dir_chunk *c = d->chunks; c != NULL; c = c->next) {
+
+                for (size_t off = 0; off < c->len; ) {
+
+                    struct linux_dirent64 *e = (struct linux_dirent64 *)(c->data + off);
+
+                    off += e->d_reclen;
+
+                    const char *name = e->d_name;
+
+                    // Hidden files only match a pattern that starts with '.', and never . or ..
+
+                    if (name[0] == '.' && (comp[0] != '.' || name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+
+                    if (!glob_match(steps, nsteps, name)) continue;
+
+                    size_t nlen = strlen(name);
+
+                    char *path = arena_alloc(a, plen + nlen + 2);
+
+                    memcpy(path, paths[p], plen);
+
+                    memcpy(path + plen, name, nlen);
+
+                    strcpy(path + plen + nlen, last ? "" : "/");
+
+                    if (dirs_only && e->d_type != DT_DIR) {
+
+                        // More components or a trailing slash follow, so this has to be a directory
+
+                        struct stat st;
+
+                        if (e->d_type != DT_LNK && e->d_type != DT_UNKNOWN) continue;
+
+                        if (stat(path, &st) != 0 || !S_ISDIR(st.st_mode)) continue;
+
+                    }
+
+                    if (nnext == next_cap) {
+
+                        next_cap = next_cap ? next_cap * 2 : 16;
+
+                        next = realloc(next, next_cap * sizeof(char *));
+
+                    }
+
+                    next[nnext++] = path;
+
+                }
+
+            }
+
+        }
+
+        free(paths);
+
+        paths = next;
+
+        npaths = nnext;
+
+        comp += clen;
+
+        while (*comp == '/') comp++;
+
+        if (literal && last) {
+
+            // A literal last component was never looked at, drop the paths that don't exist
+
+            // (or aren't directories, when the pattern ends in '/')
+
+            int kept = 0;
+
+            struct stat st;
+
+            for (int p = 0; p < npaths; p++) {
+
+                int found = dirs_only ? stat(paths[p], &st) == 0 && S_ISDIR(st.st_mode) : lstat(paths[p], &st) == 0;
+
+                if (found) paths[kept++] = paths[p];
+
+            }
+
+            npaths = kept;
+
+        }
+
+    }
+
+    free(steps);
+
+
+
+    // Keep a trailing slash from the pattern ("*/" lists directories)
+
+    size_t plen = strlen(pattern);
+
+    int trailing_slash = plen > 1 && pattern[plen - 1] == '/';
+
+    qsort(paths, npaths, sizeof(char *), compare_strings);
+
+    for (int p = 0; p < npaths; p++) {
+
+        if (*nfields + 1 >= *cap) {
+
+            *cap = *cap ? *cap * 2 : 32;
+
+            *fields = realloc(*fields, *cap * sizeof(char *));
+
+        }
+
+        char *path = paths[p];
+
+        if (trailing_slash) {
+
+            size_t len = strlen(path);
+
+            char *with = arena_alloc(a, len + 2);
+
+            memcpy(with, path, len);
+
+            strcpy(with + len, "/");
+
+            path = with;
+
+        }
+
+        (*fields)[(*nfields)++] = path;
+
+    }
+
+    free(paths);
+
+    return npaths;
+
+}
+
+
+
+// Function to expand a command's words into a NULL-terminated argument list in the arena
+
+// A word can become several arguments (a glob) or none (an unquoted empty variable)
+
+char **expand_command(const struct command *c, struct arena *a) {
+
+    static struct strbuf text, pattern;
+
+    static char **fields;  // Kept between calls, copied into the arena once the count is known
+
+    static int cap;
+
+    int nfields = 0;
+
+    for (int i = 0; i < c->nwords; i++) {
+
+        int had_quotes;
+
+        int glob = expand_text(&c->words[i], &text, &pattern, &had_quotes);
+
+        if (glob && glob_expand(pattern.data, a, &fields, &nfields, &cap) > 0) continue;
+
+        if (text.len == 0 && !had_quotes) continue;  // "$UNSET" as a whole word disappears
+
+        // Not a pattern, or nothing matched: the word itself, like sh does
+
+        if (nfields + 1 >= cap) {
+
+            cap = cap ? cap * 2 : 32;
+
+            fields = realloc(fields, cap * sizeof(char *));
+
+        }
+
+        fields[nfields++] = arena_store(a, text.data, text.len);
+
+    }
+
+    char **args = arena_alloc(a, (nfields + 1) * sizeof(char *));
+
+    memcpy(args, fields, nfields * sizeof(char *));
+
+    args[nfields] = NULL;  // Arguments end with NULL like execv() expects
+
+    return args;
+
+}
+
+
+
+// Function to hash a command name (FNV-1a)
+
+unsigned long hash_string(const char *s) {
+
+    unsigned long h = 14695981039346656037UL;
+
+    while (*s != '\0') {
+
+        h ^= (unsigned char)*s++;
+
+        h *= 1099511628211UL;
+
+    }
+
+    return h;
+
+}
+
+
+
+// Function to drop the cached entries found in directory "dir" or a later one in $PATH (-1 = all)
+
+// A new file in dir can hide any of those, so none of them is safe to keep. Returns the number dropped.
+
+int path_cache_flush(int dir) {
+
+    int dropped = 0;
+
+    for (int b = 0; b < HASH_BUCKETS; b++) {
+
+        struct path_entry **link = &path_cache.buckets[b];
+
+        while (*link != NULL) {
+
+            struct path_entry *e = *link;
+
+            if (e->dir >= dir) {
+
+                *link = e->next;
+
+                free(e->name);
+
+                free(e->path);
+
+                free(e);
+
+                dropped++;
+
+            } else {
+
+                link = &e->next;
+
+            }
+
+        }
+
+    }
+
+    return dropped;
+
+}
+
+
+
+// Function to make sure the cache matches the current $PATH, rebuilding the directory list if it changed
+
+void path_cache_sync(void) {
+
+    const char *value = getenv("PATH");
+
+    if (value == NULL) value = "/usr/local/bin:/usr/bin:/bin";  // Same default execvp() uses
+
+    if (path_cache.path_value != NULL && strcmp(path_cache.path_value, value) == 0) return;
+
+
+
+    // $PATH changed (or first use): every cached answer may now be wrong
+
+    path_cache_flush(-1);
+
+    free(path_cache.path_value);
+
+    free(path_cache.dir_buf);
+
+    free(path_cache.dirs);
+
+    free(path_cache.mtimes);
+
+    path_cache.path_value = strdup(value);
+
+
+
+    int ndirs = 1;
+
+    for (const char *c = value; *c != '\0'; c++) {
+
+        if (*c == ':') ndirs++;
+
+    }
+
+    char *copy = strdup(value);
+
+    path_cache.dir_buf = copy;
+
+    path_cache.dirs = malloc(sizeof(char *) * ndirs);
+
+    path_cache.mtimes = calloc(ndirs, sizeof(struct timespec));
+
+    path_cache.ndirs = 0;
+
+    char *start = copy;
+
+    for (char *c = copy; ; c++) {
+
+        if (*c == ':' || *c == '\0') {
+
+            int end = (*c == '\0');
+
+            *c = '\0';
+
+            // An empty entry in $PATH means the current directory
+
+            path_cache.dirs[path_cache.ndirs++] = (*start == '\0') ? "." : start;
+
+            if (end) break;
+
+            start = c + 1;
+
+        }
+
+    }
+
+}
+
+
+
+// Function to check whether directory "dir" of $PATH changed since it was last looked at, returns 1 if so
+
+// A change drops the entries found there or further down $PATH as stale and remembers the new mtime
+
+// (a missing directory counts as 0)
+
+int path_dir_changed(int dir) {
+
+    struct stat st;
+
+    struct timespec now = {0, 0};
+
+    if (stat(path_cache.dirs[dir], &st) == 0) now = st.st_mtim;
+
+    struct timespec *seen = &path_cache.mtimes[dir];
+
+    if (now.tv_sec == seen->tv_sec && now.tv_nsec == seen->tv_nsec) return 0;
+
+    path_cache.stale += path_cache_flush(dir);
+
+    *seen = now;
+
+    return 1;
+
+}
+
+
+
+// Function to resolve a command name to the path to exec, NULL if it isn't in $PATH
+
+// Names with a '/' are used as-is, like execvp() does
+
+const char *resolve_command(const char *name) {
+
+    if (strchr(name, '/') != NULL) return name;
+
+    path_cache_sync();
+
+
+
+    unsigned long bucket = hash_string(name) & (HASH_BUCKETS - 1);
+
+    for (struct path_entry *e = path_cache.buckets[bucket]; e != NULL; e = e->next) {
+
+        if (strcmp(e->name, name) != 0) continue;
+
+        // One stat() per $PATH directory up to the one it was found in, instead of a failed execve() each:
+
+        // a change there may have removed it, a change in an earlier one may have added one that comes first
+
+        int dir = e->dir;
+
+        int changed = 0;
+
+        for (int d = 0; d <= dir && !changed; d++) changed = path_dir_changed(d);
+
+        if (!changed) {
+
+            e->hits++;
+
+            path_cache.hits++;
+
+            return e->path;
+
+        }
+
+        // The change dropped e along with the rest of that part of the cache: look it up again
+
+        break;
+
+    }
+
+
+
+    // Walk $PATH the slow way and remember the answer
+
+    path_cache.misses++;
+
+    for (int d = 0; d < path_cache.ndirs; d++) {
+
+        // Remember each directory's mtime as it is searched, dropping what older ones vouched for
+
+        path_dir_changed(d);
+
+        size_t len = strlen(path_cache.dirs[d]) + strlen(name) + 2;
+
+        char *full = malloc(len);
+
+        snprintf(full, len, "%s/%s", path_cache.dirs[d], name);
+
+        struct stat st;
+
+        if (stat(full, &st) == 0 && S_ISREG(st.st_mode) && access(full, X_OK) == 0) {
+
+            struct path_entry *e = malloc(sizeof(struct path_entry));
+
+            e->name = strdup(name);
+
+            e->path = full;
+
+            e->dir = d;
+
+            e->hits = 1;
+
+            e->next = path_cache.buckets[bucket];
+
+            path_cache.buckets[bucket] = e;
+
+            return e->path;
+
+        }
+
+        free(full);
+
+    }
+
+    return NULL;
+
+}
+
+
+
+// Built-in "hash": show the PATH cache, "hash -r" empties it, "hash -s" prints hit/miss counters,
+
+// "hash name..." looks names up ahead of time
+
+int builtin_hash(char **args, struct writer *out) {
+
+    if (args[1] != NULL && strcmp(args[1], "-r") == 0) {
+
+        path_cache_flush(-1);
+
+        return 0;
+
+    }
+
+    if (args[1] != NULL && strcmp(args[1], "-s") == 0) {
+
+        writer_printf(out, "hits %lu misses %lu stale %lu\n", path_cache.hits, path_cache.misses, path_cache.stale);
+
+        return 0;
+
+    }
+
+    if (args[1] != NULL) {
+
+        int status = 0;
+
+        for (int i = 1; args[i] != NULL; i++) {
+
+            if (resolve_command(args[i]) == NULL) {
+
+                fprintf(stderr, "hash: %s: not found\n", args[i]);
+
+                status = 1;
+
+            }
+
+        }
+
+        return status;
+
+    }
+
+    writer_puts(out, "hits\tcommand\n");
+
+    for (int b = 0; b < HASH_BUCKETS; b++) {
+
+        for (struct path_entry *e = path_cache.buckets[b]; e != NULL; e = e->next) {
+
+            writer_printf(out, "%4lu\t%s\n", e->hits, e->path);
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Function to undo the shell's signal setup in a new child: default actions, nothing blocked
+
+void reset_child_signals(void) {
+
+    signal(SIGINT, SIG_DFL);
+
+    signal(SIGQUIT, SIG_DFL);
+
+    signal(SIGTSTP, SIG_DFL);
+
+    signal(SIGTTIN, SIG_DFL);
+
+    signal(SIGTTOU, SIG_DFL);
+
+    sigset_t none;
+
+    sigemptyset(&none);
+
+    sigprocmask(SIG_SETMASK, &none, NULL);
+
+}
+
+
+
+// Function to put a here-string's text, plus the newline sh adds, in a memory file
+
+// Returns an fd positioned at the start, or -1 with errno set
+
+int open_string(const char *text) {
+
+    int fd = memfd_create("herestring", MFD_CLOEXEC);
+
+    if (fd < 0) return -1;
+
+    size_t len = strlen(text);
+
+    if (write(fd, text, len) != (ssize_t)len || write(fd, "\n", 1) != 1 || lseek(fd, 0, SEEK_SET) != 0) {
+
+        int err = errno;
+
+        close(fd);
+
+        errno = err;
+
+        return -1;
+
+    }
+
+    return fd;
+
+}
+
+
+
+// Function to open the files a command's redirections name and turn them into fd actions for io
+
+// The shell opens them itself so a bad file is reported before anything is started
+
+// Every fd opened is added to opened[] for the caller to close; returns -1 after printing an error
+
+int open_redirects(const struct command *c, struct arena *a, struct child_io *io, int *opened, int *nopened) {
+
+    int n = 0;
+
+    for (const struct redirect *r = c->redirs; r != NULL; r = r->next) n++;
+
+    struct fd_action *actions = arena_alloc(a, n * sizeof(struct fd_action));
+
+    io->actions = actions;
+
+    io->nactions = 0;
+
+
+
+    for (const struct redirect *r = c->redirs; r != NULL; r = r->next) {
+
+        char *target = expand_word(&r->target, a);
+
+        int source;
+
+        if (r->type == REDIR_DUP) {
+
+            // "n>&m" copies an fd the command will already have, "n>&-" closes n
+
+            char *end;
+
+            long m = strtol(target, &end, 10);
+
+            if (strcmp(target, "-") == 0) {
+
+                source = -1;
+
+            } else if (*target == '\0' || *end != '\0' || m < 0 || m > 1024) {
+
+                fprintf(stderr, "myShell: %s: bad file descriptor\n", target);
+
+                return -1;
+
+            } else {
+
+                source = m;
+
+            }
+
+            actions[io->nactions].fd = r->fd;
+
+            actions[io->nactions].source = source;
+
+            io->nactions++;
+
+            continue;
+
+        }
+
+
+
+        if (r->type == REDIR_IN) source = open(target, O_RDONLY | O_CLOEXEC);
+
+        else if (r->type == REDIR_OUT) source = open(target, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+
+        else if (r->type == REDIR_APPEND) source = open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+
+        else source = open_string(target);
+
+        if (source < 0) {
+
+            fprintf(stderr, "myShell: %s: %s\n", target, strerror(errno));
+
+            return -1;
+
+        }
+
+        opened[(*nopened)++] = source;
+
+        actions[io->nactions].fd = r->fd;
+
+        actions[io->nactions].source = source;
+
+        io->nactions++;
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Function to apply a child's redirections with dup2(), for children started with fork()
+
+int apply_redirects(const struct child_io *io) {
+
+    for (int i = 0; i < io->nactions; i++) {
+
+        const struct fd_action *act = &io->actions[i];
+
+        if (act->source < 0) {
+
+            close(act->fd);
+
+        } else if (dup2(act->source, act->fd) < 0) {
+
+            fprintf(stderr, "myShell: %d: %s\n", act->source, strerror(errno));
+
+            return -1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Function to put back the first count fds redirect_shell_fds() replaced, newest first
+
+void restore_shell_fds(const struct child_io *io, int *saved, int count) {
+
+    fflush(stdout);
+
+    for (int i = count - 1; i >= 0; i--) {
+
+        if (saved[i] >= 0) {
+
+            dup2(saved[i], io->actions[i].fd);
+
+            close(saved[i]);
+
+        } else {
+
+            close(io->actions[i].fd);
+
+        }
+
+    }
+
+}
+
+
+
+// Function to apply a built-in's redirections to the shell itself, saving each fd they replace in saved[]
+
+// On failure whatever was already applied is put back and -1 is returned
+
+int redirect_shell_fds(const struct child_io *io, int *saved) {
+
+    fflush(stdout);  // Anything stdio still holds belongs to the old stdout
+
+    for (int i = 0; i < io->nactions; i++) {
+
+        const struct fd_action *act = &io->actions[i];
+
+        saved[i] = fcntl(act->fd, F_DUPFD_CLOEXEC, 10);  // -1 when the fd wasn't open before
+
+        if (act->source < 0) {
+
+            close(act->fd);
+
+        } else if (dup2(act->source, act->fd) < 0) {
+
+            fprintf(stderr, "myShell: %d: %s\n", act->source, strerror(errno));
+
+            if (saved[i] >= 0) close(saved[i]);
+
+            restore_shell_fds(io, saved, i);
+
+            return -1;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Function to start a command with the given backend, returns the child's pid or -1
+
+// io may be NULL when the child keeps the shell's stdin/stdout
+
+pid_t launch_command(char **args, enum spawn_backend backend, const struct child_io *io) {
+
+    // Find the program once in the parent, so the child goes straight to execve() on a known path
+
+    const char *path = resolve_command(args[0]);
+
+    if (path == NULL) {
+
+        fprintf(stderr, "Command execution failed: %s: command not found\n", args[0]);
+
+        return -1;
+
+    }
+
+
+
+    if (backend == SPAWN_POSIX) {
+
+        // posix_spawn() uses vfork/CLONE_VM under the hood, so the cost doesn't grow with the shell
+
+        pid_t pid;
+
+        posix_spawn_file_actions_t actions;
+
+        posix_spawn_file_actions_init(&actions);
+
+        // Pipe ends and redirected files are opened O_CLOEXEC, so dup2/close are the only file actions needed
+
+        if (io != NULL && io->in >= 0) posix_spawn_file_actions_adddup2(&actions, io->in, STDIN_FILENO);
+
+        if (io != NULL && io->out >= 0) posix_spawn_file_actions_adddup2(&actions, io->out, STDOUT_FILENO);
+
+        if (io != NULL && io->err >= 0) posix_spawn_file_actions_adddup2(&actions, io->err, STDERR_FILENO);
+
+        for (int i = 0; io != NULL && i < io->nactions; i++) {
+
+            if (io->actions[i].source < 0) posix_spawn_file_actions_addclose(&actions, io->actions[i].fd);
+
+            else posix_spawn_file_actions_adddup2(&actions, io->actions[i].source, io->actions[i].fd);
+
+        }
+
+
+
+        // The shell blocks SIGCHLD and ignores the job-control signals, the child must not inherit that
+
+        posix_spawnattr_t attr;
+
+        posix_spawnattr_init(&attr);
+
+        sigset_t none, defaults;
+
+        sigemptyset(&none);
+
+        sigemptyset(&defaults);
+
+        sigaddset(&defaults, SIGINT);
+
+        sigaddset(&defaults, SIGQUIT);
+
+        sigaddset(&defaults, SIGTSTP);
+
+        sigaddset(&defaults, SIGTTIN);
+
+        sigaddset(&defaults, SIGTTOU);
+
+        posix_spawnattr_setsigmask(&attr, &none);
+
+        posix_spawnattr_setsigdefault(&attr, &defaults);
+
+        short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+
+        if (io != NULL && io->pgid >= 0) {
+
+            flags |= POSIX_SPAWN_SETPGROUP;
+
+            posix_spawnattr_setpgroup(&attr, io->pgid);
+
+        }
+
+        posix_spawnattr_setflags(&attr, flags);
+
+
+
+        int err = posix_spawn(&pid, path, &actions, &attr, args, environ);
+
+        posix_spawn_file_actions_destroy(&actions);
+
+        posix_spawnattr_destroy(&attr);
+
+        if (err != 0) {
+
+            // The exec failure is reported back to us instead of happening in the child
+
+            fprintf(stderr, "Command execution failed: %s\n", strerror(err));
+
+            return -1;
+
+        }
+
+        return pid;
+
+    }
+
+
+
+    // Create a new process using fork()
+
+    pid_t pid = fork();
+
+
+
+    if (pid < 0) {
+
+        // Fork failed
+
+        perror("Fork failed");
+
+    } else if (pid == 0) {
+
+        // Child process: join the job's process group, connect the pipe ends, then execute the command
+
+        if (io != NULL && io->pgid >= 0) setpgid(0, io->pgid);
+
+        reset_child_signals();
+
+        if (io != NULL && io->in >= 0) dup2(io->in, STDIN_FILENO);
+
+        if (io != NULL && io->out >= 0) dup2(io->out, STDOUT_FILENO);
+
+        if (io != NULL && io->err >= 0) dup2(io->err, STDERR_FILENO);
+
+        if (io != NULL && apply_redirects(io) != 0) _exit(1);
+
+        execv(path, args);
+
+        perror("Command execution failed");  // Handle invalid commands
+
+        _exit(127);  // Terminate child process if execv fails
+
+    } else if (io != NULL && io->pgid >= 0) {
+
+        // Set the group from the parent too, so it's in place before we hand it the terminal
+
+        setpgid(pid, io->pgid ? io->pgid : pid);
+
+    }
+
+    return pid;
+
+}
+
+
+
+// Function to wait for one specific child, returns its wait status
+
+int wait_for_child(pid_t pid) {
+
+    int status = 0;
+
+    // waitpid() on the exact pid, wait(NULL) could reap some other child
+
+    while (waitpid(pid, &status, 0) < 0) {
+
+        if (errno != EINTR) {
+
+            perror("waitpid failed");
+
+            break;
+
+        }
+
+    }
+
+    return status;
+
+}
+
+
+
+// Compare function for sorting latency samples
+
+int compare_samples(const void *a, const void *b) {
+
+    long long x = *(const long long *)a;
+
+    long long y = *(const long long *)b;
+
+    return (x > y) - (x < y);
+
+}
+
+
+
+// Function to time N spawn-to-exit round trips of a command under both backends
+
+// Usage: spawnbench [-n runs] [command args...]   (default: 1000 runs of "true")
+
+int builtin_spawnbench(char **args, struct writer *out) {
+
+    int runs = 1000;
+
+    int i = 1;
+
+    if (args[i] != NULL && strcmp(args[i], "-n") == 0 && args[i + 1] != NULL) {
+
+        runs = atoi(args[i + 1]);
+
+        i += 2;
+
+    }
+
+    if (runs <= 0) {
+
+        fprintf(stderr, "spawnbench: run count must be positive\n");
+
+        return 2;
+
+    }
+
+    char *default_cmd[] = {"true", NULL};
+
+    char **cmd = (args[i] != NULL) ? &args[i] : default_cmd;
+
+
+
+    long long *samples = malloc(sizeof(long long) * runs);
+
+    if (samples == NULL) {
+
+        perror("spawnbench");
+
+        return 1;
+
+    }
+
+
+
+    const char *names[] = {"posix_spawn", "fork"};
+
+    enum spawn_backend backends[] = {SPAWN_POSIX, SPAWN_FORK};
+
+    writer_printf(out, "%-12s %8s %12s %12s\n", "backend", "runs", "median_us", "p99_us");
+
+    for (int b = 0; b < 2; b++) {
+
+        int done = 0;
+
+        for (int r = 0; r < runs; r++) {
+
+            long long start = now_ns();
+
+            pid_t pid = launch_command(cmd, backends[b], NULL);
+
+            if (pid < 0) break;
+
+            wait_for_child(pid);
+
+            samples[done++] = now_ns() - start;
+
+        }
+
+        if (done == 0) continue;
+
+        // Sort so the median and p99 can be read straight out of the array
+
+        qsort(samples, done, sizeof(long long), compare_samples);
+
+        long long median = samples[done / 2];
+
+        long long p99 = samples[(done * 99) / 100];
+
+        writer_printf(out, "%-12s %8d %12.1f %12.1f\n", names[b], done, median / 1000.0, p99 / 1000.0);
+
+    }
+
+    free(samples);
+
+    return 0;
+
+}
+
+
+
+// Function to check whether a file descriptor is a pipe (splice() needs one on either side)
+
+int is_pipe(int fd) {
+
+    struct stat st;
+
+    return fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+
+}
+
+
+
+// Function to copy everything from one fd to another
+
+// Uses splice() so the data stays in the kernel, falls back to read()/write() when neither side is a pipe
+
+int copy_fd(int in, int out) {
+
+    while (1) {
+
+        ssize_t n = splice(in, NULL, out, NULL, PIPE_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE);
+
+        if (n == 0) return 0;  // End of input
+
+        if (n > 0) continue;
+
+        if (errno == EINTR) continue;
+
+        if (errno == EINVAL) break;  // splice() not possible for this pair, copy by hand instead
+
+        return -1;
+
+    }
+
+
+
+    static char buf[PIPE_CHUNK];
+
+    ssize_t n;
+
+    while ((n = read(in, buf, sizeof(buf))) != 0) {
+
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+
+            return -1;
+
+        }
+
+        for (ssize_t off = 0; off < n; ) {
+
+            ssize_t w = write(out, buf + off, n - off);
+
+            if (w < 0) {
+
+                if (errno == EINTR) continue;
+
+                return -1;
+
+            }
+
+            off += w;
+
+        }
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Built-in "cat" pipeline stage: concatenate files (or stdin) to stdout
+
+int stage_cat(char **args) {
+
+    int status = 0;
+
+    if (args[1] == NULL) {
+
+        return copy_fd(STDIN_FILENO, STDOUT_FILENO) == 0 ? 0 : 1;
+
+    }
+
+    for (int i = 1; args[i] != NULL; i++) {
+
+        int fd = open(args[i], O_RDONLY | O_CLOEXEC);
+
+        if (fd < 0) {
+
+            fprintf(stderr, "cat: %s: %s\n", args[i], strerror(errno));
+
+            status = 1;
+
+            continue;
+
+        }
+
+        if (copy_fd(fd, STDOUT_FILENO) != 0) status = 1;
+
+        close(fd);
+
+    }
+
+    return status;
+
+}
+
+
+
+// Built-in "tee" pipeline stage: copy stdin to stdout and to a file
+
+// With one file and pipes on both sides, tee() duplicates the data and splice() drains it into the file
+
+int stage_tee(char **args) {
+
+    int i = 1;
+
+    int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+
+    if (args[i] != NULL && strcmp(args[i], "-a") == 0) {
+
+        flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+
+        i++;
+
+    }
+
+
+
+    int argc = 0;
+
+    while (args[argc] != NULL) argc++;
+
+    int *files = malloc(sizeof(int) * argc);
+
+    int nfiles = 0;
+
+    int status = 0;
+
+    for (; args[i] != NULL; i++) {
+
+        int fd = open(args[i], flags, 0644);
+
+        if (fd < 0) {
+
+            fprintf(stderr, "tee: %s: %s\n", args[i], strerror(errno));
+
+            status = 1;
+
+            continue;
+
+        }
+
+        files[nfiles++] = fd;
+
+    }
+
+
+
+    int zero_copy = nfiles == 1 && is_pipe(STDIN_FILENO) && is_pipe(STDOUT_FILENO);
+
+    while (zero_copy) {
+
+        ssize_t n = tee(STDIN_FILENO, STDOUT_FILENO, PIPE_CHUNK, 0);
+
+        if (n == 0) goto done;
+
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+
+            if (errno == EINVAL) break;  // Not usable here, fall back to the copying loop
+
+            status = 1;
+
+            goto done;
+
+        }
+
+        // tee() only peeked at the data, splice() the same bytes into the file to consume them
+
+        while (n > 0) {
+
+            ssize_t m = splice(STDIN_FILENO, NULL, files[0], NULL, n, SPLICE_F_MOVE);
+
+            if (m < 0) {
+
+                if (errno == EINTR) continue;
+
+                status = 1;
+
+                goto done;
+
+            }
+
+            n -= m;
+
+        }
+
+    }
+
+
+
+    // Copying fallback: more than one file, or stdin/stdout isn't a pipe
+
+    static char buf[PIPE_CHUNK];
+
+    ssize_t n;
+
+    while ((n = read(STDIN_FILENO, buf, sizeof(buf))) != 0) {
+
+        if (n < 0) {
+
+            if (errno == EINTR) continue;
+
+            status = 1;
+
+            break;
+
+        }
+
+        if (write(STDOUT_FILENO, buf, n) != n) status = 1;
+
+        for (int f = 0; f < nfiles; f++) {
+
+            if (write(files[f], buf, n) != n) status = 1;
+
+        }
+
+    }
+
+
+
+done:
+
+    for (int f = 0; f < nfiles; f++) close(files[f]);
+
+    free(files);
+
+    return status;
+
+}
+
+
+
+// Function to check whether a pipeline stage can run as a splice()-based built-in
+
+// Only plain "cat [files]" and "tee [-a] file..." are handled, anything with other options is exec'd
+
+int is_stage_builtin(char **args) {
+
+    if (!fastpipe) return 0;
+
+    for (int i = 1; args[i] != NULL; i++) {
+
+        if (args[i][0] == '-' && !(strcmp(args[0], "tee") == 0 && i == 1 && strcmp(args[i], "-a") == 0)) {
+
+            return 0;
+
+        }
+
+    }
+
+    return strcmp(args[0], "cat") == 0 || strcmp(args[0], "tee") == 0;
+
+}
+
+
+
+// Built-in "exit": leave the shell with the given status, or the last command's status
+
+int builtin_exit(char **args, struct writer *out) {
+
+    writer_flush(out);
+
+    exit(args[1] != NULL ? atoi(args[1]) : last_status);
+
+}
+
+
+
+// Built-in "cd": change the shell's own directory (can't work as a child process)
+
+int builtin_cd(char **args, struct writer *out) {
+
+    const char *dir = args[1];
+
+    if (dir == NULL) {
+
+        dir = getenv("HOME");
+
+        if (dir == NULL) {
+
+            fprintf(stderr, "cd: HOME not set\n");
+
+            return 1;
+
+        }
+
+    } else if (strcmp(dir, "-") == 0) {
+
+        dir = getenv("OLDPWD");
+
+        if (dir == NULL) {
+
+            fprintf(stderr, "cd: OLDPWD not set\n");
+
+            return 1;
+
+        }
+
+        writer_printf(out, "%s\n", dir);
+
+    }
+
+
+
+    char old[4096];
+
+    if (getcwd(old, sizeof(old)) == NULL) old[0] = '\0';
+
+    if (chdir(dir) != 0) {
+
+        fprintf(stderr, "cd: %s: %s\n", dir, strerror(errno));
+
+        return 1;
+
+    }
+
+    // Keep PWD/OLDPWD up to date for children and for "cd -"
+
+    char now[4096];
+
+    if (old[0] != '\0') setenv("OLDPWD", old, 1);
+
+    if (getcwd(now, sizeof(now)) != NULL) setenv("PWD", now, 1);
+
+    return 0;
+
+}
+
+
+
+// Built-in "pwd": print the current directory
+
+int builtin_pwd(char **args, struct writer *out) {
+
+    (void)args;
+
+    char cwd[4096];
+
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+
+        perror("pwd");
+
+        return 1;
+
+    }
+
+    writer_printf(out, "%s\n", cwd);
+
+    return 0;
+
+}
+
+
+
+// Built-in "echo": print the arguments separated by spaces, "-n" drops the newline
+
+int builtin_echo(char **args, struct writer *out) {
+
+    int i = 1;
+
+    int newline = 1;
+
+    if (args[i] != NULL && strcmp(args[i], "-n") == 0) {
+
+        newline = 0;
+
+        i++;
+
+    }
+
+    for (int first = i; args[i] != NULL; i++) {
+
+        if (i > first) writer_put(out, " ", 1);
+
+        writer_puts(out, args[i]);
+
+    }
+
+    if (newline) writer_put(out, "\n", 1);
+
+    return 0;
+
+}
+
+
+
+// Built-in "export": set environment variables (NAME=VALUE), or list them with no arguments
+
+int builtin_export(char **args, struct writer *out) {
+
+    if (args[1] == NULL) {
+
+        for (char **env = environ; *env != NULL; env++) {
+
+            writer_printf(out, "export %s\n", *env);
+
+        }
+
+        return 0;
+
+    }
+
+    int status = 0;
+
+    for (int i = 1; args[i] != NULL; i++) {
+
+        char *eq = strchr(args[i], '=');
+
+        if (eq == NULL) continue;  // "export NAME": already visible to children if it's set
+
+        *eq = '\0';
+
+        if (args[i][0] == '\0' || setenv(args[i], eq + 1, 1) != 0) {
+
+            fprintf(stderr, "export: invalid variable name '%s'\n", args[i]);
+
+            status = 1;
+
+        }
+
+        *eq = '=';
+
+    }
+
+    return status;
+
+}
+
+
+
+// Built-ins "true" and "false"
+
+int builtin_true(char **args, struct writer *out) {
+
+    (void)args;
+
+    (void)out;
+
+    return 0;
+
+}
+
+
+
+int builtin_false(char **args, struct writer *out) {
+
+    (void)args;
+
+    (void)out;
+
+    return 1;
+
+}
+
+
+
+// Function to evaluate a unary file test like "-f path"
+
+int test_file(const char *op, const char *path) {
+
+    struct stat st;
+
+    if (strcmp(op, "-r") == 0) return access(path, R_OK) == 0;
+
+    if (strcmp(op, "-w") == 0) return access(path, W_OK) == 0;
+
+    if (strcmp(op, "-x") == 0) return access(path, X_OK) == 0;
+
+    if (stat(path, &st) != 0) return 0;
+
+    if (strcmp(op, "-e") == 0) return 1;
+
+    if (strcmp(op, "-f") == 0) return S_ISREG(st.st_mode);
+
+    if (strcmp(op, "-d") == 0) return S_ISDIR(st.st_mode);
+
+    if (strcmp(op, "-s") == 0) return st.st_size > 0;
+
+    return -1;
+
+}
+
+
+
+// Built-in "test" (and "["): 0 if the expression is true, 1 if false, 2 on a bad expression
+
+// Supports "! expr", "-n/-z str", file tests, "a = b", "a != b" and the integer comparisons
+
+int builtin_test(char **args, struct writer *out) {
+
+    (void)out;
+
+    int argc = 0;
+
+    while (args[argc] != NULL) argc++;
+
+    if (strcmp(args[0], "[") == 0) {
+
+        if (strcmp(args[argc - 1], "]") != 0) {
+
+            fprintf(stderr, "[: missing ']'\n");
+
+            return 2;
+
+        }
+
+        argc--;
+
+    }
+
+
+
+    char **a = args + 1;
+
+    int n = argc - 1;
+
+    int negate = 0;
+
+    if (n > 0 && strcmp(a[0], "!") == 0) {
+
+        negate = 1;
+
+        a++;
+
+        n--;
+
+    }
+
+
+
+    int result;
+
+    if (n == 0) {
+
+        result = 0;
+
+    } else if (n == 1) {
+
+        result = a[0][0] != '\0';
+
+    } else if (n == 2) {
+
+        if (strcmp(a[0], "-n") == 0) result = a[1][0] != '\0';
+
+        else if (strcmp(a[0], "-z") == 0) result = a[1][0] == '\0';
+
+        else result = test_file(a[0], a[1]);
+
+    } else if (n == 3) {
+
+        const char *op = a[1];
+
+        long x = strtol(a[0], NULL, 10);
+
+        long y = strtol(a[2], NULL, 10);
+
+        if (strcmp(op, "=") == 0 || strcmp(op, "==") == 0) result = strcmp(a[0], a[2]) == 0;
+
+        else if (strcmp(op, "!=") == 0) result = strcmp(a[0], a[2]) != 0;
+
+        else if (strcmp(op, "-eq") == 0) result = x == y;
+
+        else if (strcmp(op, "-ne") == 0) result = x != y;
+
+        else if (strcmp(op, "-lt") == 0) result = x < y;
+
+        else if (strcmp(op, "-le") == 0) result = x <= y;
+
+        else if (strcmp(op, "-gt") == 0) result = x > y;
+
+        else if (strcmp(op, "-ge") == 0) result = x >= y;
+
+        else result = -1;
+
+    } else {
+
+        result = -1;
+
+    }
+
+
+
+    if (result < 0) {
+
+        fprintf(stderr, "%s: unsupported expression\n", args[0]);
+
+        return 2;
+
+    }
+
+    return (result ^ negate) ? 0 : 1;
+
+}
+
+
+
+// Built-in "spawnmode": show or pick the launch backend
+
+int builtin_spawnmode(char **args, struct writer *out) {
+
+    if (args[1] == NULL) {
+
+        writer_printf(out, "%s\n", spawn_backend == SPAWN_POSIX ? "spawn" : "fork");
+
+    } else if (strcmp(args[1], "spawn") == 0) {
+
+        spawn_backend = SPAWN_POSIX;
+
+    } else if (strcmp(args[1], "fork") == 0) {
+
+        spawn_backend = SPAWN_FORK;
+
+    } else {
+
+        fprintf(stderr, "spawnmode: expected 'spawn' or 'fork'\n");
+
+        return 2;
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Built-in "fastpipe": turn the splice()-based cat/tee stages on or off
+
+int builtin_fastpipe(char **args, struct writer *out) {
+
+    if (args[1] == NULL) {
+
+        writer_printf(out, "%s\n", fastpipe ? "on" : "off");
+
+    } else if (strcmp(args[1], "on") == 0 || strcmp(args[1], "off") == 0) {
+
+        fastpipe = strcmp(args[1], "on") == 0;
+
+    } else {
+
+        fprintf(stderr, "usage: fastpipe [on|off]\n");
+
+        return 2;
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Function to find the job named by "%n", a pid, or the most recent job when spec is NULL
+
+struct job *find_job(const char *spec, const char *who) {
+
+    struct job *j = job_list;
+
+    if (spec != NULL) {
+
+        int n = atoi(spec[0] == '%' ? spec + 1 : spec);
+
+        for (j = job_list; j != NULL; j = j->next) {
+
+            if (spec[0] == '%' ? j->id == n : (j->pgid == n || (j->nprocs > 0 && j->procs[0].pid == n))) break;
+
+        }
+
+    }
+
+    if (j == NULL) fprintf(stderr, "%s: %s: no such job\n", who, spec ? spec : "current");
+
+    return j;
+
+}
+
+
+
+// Built-in "jobs": list background and stopped jobs
+
+int builtin_jobs(char **args, struct writer *out) {
+
+    (void)args;
+
+    reap_children();
+
+    // The list is newest first, print oldest first like other shells
+
+    int count = 0;
+
+    for (struct job *j = job_list; j != NULL; j = j->next) count++;
+
+    for (int k = count - 1; k >= 0; k--) {
+
+        struct job *j = job_list;
+
+        for (int s = 0; s < k; s++) j = j->next;
+
+        const char *state = j->state == JOB_RUNNING ? "Running" : j->state == JOB_STOPPED ? "Stopped" : "Done";
+
+        writer_printf(out, "[%d]%c  %-8s\t%s\n", j->id, j == job_list ? '+' : ' ', state, j->command);
+
+    }
+
+    return 0;
+
+}
+
+
+
+// Built-in "fg": bring a job to the foreground (continuing it if stopped) and wait for it
+
+int builtin_fg(char **args, struct writer *out) {
+
+    struct job *j = find_job(args[1], "fg");
+
+    if (j == NULL) return 1;
+
+    writer_printf(out, "%s\n", j->command);
+
+    writer_flush(out);
+
+    j->background = 0;
+
+    if (j->state == JOB_STOPPED) {
+
+        j->state = JOB_RUNNING;
+
+        if (j->pgid > 0) kill(-j->pgid, SIGCONT);
+
+        else for (int p = 0; p < j->nprocs; p++) kill(j->procs[p].pid, SIGCONT);
+
+    }
+
+    int status = wait_for_job(j, 1);
+
+    if (j->state == JOB_DONE) free_job(j);
+
+    return status;
+
+}
+
+
+
+// Built-in "bg": let a stopped job carry on in the background
+
+int builtin_bg(char **args, struct writer *out) {
+
+    struct job *j = find_job(args[1], "bg");
+
+    if (j == NULL) return 1;
+
+    if (j->state == JOB_STOPPED) {
+
+        j->state = JOB_RUNNING;
+
+        j->background = 1;
+
+        if (j->pgid > 0) kill(-j->pgid, SIGCONT);
+
+        else for (int p = 0; p < j->nprocs; p++) kill(j->procs[p].pid, SIGCONT);
+
+    }
+
+    writer_printf(out, "[%d]  %s &\n", j->id, j->command);
+
+    return 0;
+
+}
+
+
+
+// Built-in "wait": wait for the given jobs/pids, or for every running background job
+
+int builtin_wait(char **args, struct writer *out) {
+
+    (void)out;
+
+    int status = 0;
+
+    if (args[1] == NULL) {
+
+        // Restart the scan after each wait, finished jobs are freed along the way
+
+        struct job *j;
+
+        do {
+
+            for (j = job_list; j != NULL && j->state != JOB_RUNNING; j = j->next) {
+
+            }
+
+            if (j != NULL) status = wait_for_job(j, 0);
+
+        } while (j != NULL);
+
+        report_jobs(0);
+
+        return status;
+
+    }
+
+    for (int i = 1; args[i] != NULL; i++) {
+
+        struct job *j = find_job(args[i], "wait");
+
+        if (j == NULL) {
+
+            status = 127;
+
+            continue;
+
+        }
+
+        status = wait_for_job(j, 0);
+
+        if (j->state == JOB_DONE) free_job(j);
+
+    }
+
+    return status;
+
+}
+
+
+
+// Function to get the default accounting log path, ~/.myshell_acct (caller frees)
+
+char *default_acct_path(void) {
+
+    const char *home = getenv("HOME");
+
+    if (home == NULL) home = ".";
+
+    char *path = malloc(strlen(home) + sizeof("/.myshell_acct"));
+
+    if (path != NULL) sprintf(path, "%s/.myshell_acct", home);
+
+    return path;
+
+}
+
+
+
+// Built-in "acct": log the resource usage of every command that finishes
+
+// Usage: acct on [file]   start appending to file (default ~/.myshell_acct)
+
+//        acct off         stop logging
+
+//        acct             show whether logging is on
+
+int builtin_acct(char **args, struct writer *out) {
+
+    if (args[1] == NULL) {
+
+        if (acct_fd >= 0) writer_printf(out, "accounting on: %s\n", acct_path);
+
+        else writer_puts(out, "accounting off\n");
+
+        return 0;
+
+    }
+
+    if (strcmp(args[1], "off") == 0) {
+
+        if (acct_fd >= 0) close(acct_fd);
+
+        free(acct_path);
+
+        acct_fd = -1;
+
+        acct_path = NULL;
+
+        return 0;
+
+    }
+
+    if (strcmp(args[1], "on") != 0) {
+
+        fprintf(stderr, "usage: acct [on [file] | off]\n");
+
+        return 2;
+
+    }
+
+
+
+    char *path = args[2] != NULL ? strdup(args[2]) : default_acct_path();
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+    if (fd < 0) {
+
+        fprintf(stderr, "acct: %s: %s\n", path, strerror(errno));
+
+        free(path);
+
+        return 1;
+
+    }
+
+    // New log: start with a header so the columns can be read without this source
+
+    struct stat st;
+
+    static const char header[] = "# epoch,status,real,user,sys,maxrss_kb,vcsw,ivcsw,command\n";
+
+    if (fstat(fd, &st) == 0 && st.st_size == 0 && write(fd, header, sizeof(header) - 1) < 0) {
+
+        perror("acct");
+
+    }
+
+    if (acct_fd >= 0) close(acct_fd);
+
+    free(acct_path);
+
+    acct_fd = fd;
+
+    acct_path = path;
+
+    return 0;
+
+}
+
+
+
+// Totals for one command name in "sa"
+
+struct acct_total {
+
+    char *name;
+
+    long calls;
+
+    long failed;
+
+    double real, user, sys;  // Seconds
+
+    long long rss_sum;       // KB, for the average
+
+    long rss_max;
+
+    struct acct_total *next; // Next in the same hash bucket
+
+};
+
+
+
+// Compare function for sorting totals: most CPU time (user + sys) first
+
+int compare_totals(const void *a, const void *b) {
+
+    const struct acct_total *x = *(struct acct_total *const *)a;
+
+    const struct acct_total *y = *(struct acct_total *const *)b;
+
+    double cx = x->user + x->sys;
+
+    double cy = y->user + y->sys;
+
+    return (cx < cy) - (cx > cy);
+
+}
+
+
+
+// Built-in "sa": summarize the accounting log by command name
+
+// Usage: sa [file]   (default: the log acct is writing, or ~/.myshell_acct)
+
+int builtin_sa(char **args, struct writer *out) {
+
+    char *path = args[1] != NULL ? strdup(args[1]) : acct_path != NULL ? strdup(acct_path) : default_acct_path();
+
+
+
+    // The log is read like a script: mmap()ed and split into lines in place
+
+    struct input in = {0};
+
+    struct arena line = {0};
+
+    if (open_script(&in, path) != 0) {
+
+        free(path);
+
+        return 1;
+
+    }
+
+
+
+    struct acct_total *buckets[HASH_BUCKETS] = {0};
+
+    struct acct_total **all = NULL;
+
+    size_t ntotals = 0, cap = 0;
+
+    long bad = 0;
+
+    while (1) {
+
+        arena_reset(&line);
+
+        char *text = next_line(&in, &line);
+
+        if (text == NULL) break;
+
+        if (text[0] == '#' || text[0] == '\0') continue;
+
+        int status, name_at = 0;
+
+        double real, user, sys;
+
+        long rss;
+
+        if (sscanf(text, "%*f,%d,%lf,%lf,%lf,%ld,%*d,%*d,%n", &status, &real, &user, &sys, &rss, &name_at) != 5 ||
+
+            name_at == 0) {
+
+            bad++;
+
+            continue;
+
+        }
+
+        const char *name = text + name_at;
+
+        unsigned long h = hash_string(name) & (HASH_BUCKETS - 1);
+
+        struct acct_total *t = buckets[h];
+
+        while (t != NULL && strcmp(t->name, name) != 0) t = t->next;
+
+        if (t == NULL) {
+
+            t = calloc(1, sizeof(struct acct_total));
+
+            t->name = strdup(name);
+
+            t->next = buckets[h];
+
+            buckets[h] = t;
+
+            if (ntotals == cap) {
+
+                cap = cap ? cap * 2 : 64;
+
+                all = realloc(all, cap * sizeof(struct acct_total *));
+
+            }
+
+            all[ntotals++] = t;
+
+        }
+
+        t->calls++;
+
+        if (status != 0) t->failed++;
+
+        t->real += real;
+
+        t->user += user;
+
+        t->sys += sys;
+
+        t->rss_sum += rss;
+
+        if (rss > t->rss_max) t->rss_max = rss;
+
+    }
+
+
+
+    qsort(all, ntotals, sizeof(struct acct_total *), compare_totals);
+
+    writer_printf(out, "%8s %7s %10s %10s %10s %11s %11s  %s\n",
+
+                  "calls", "failed", "real", "user", "sys", "avg_rss_kb", "max_rss_kb", "command");
+
+    for (size_t i = 0; i < ntotals; i++) {
+
+        struct acct_total *t = all[i];
+
+        writer_printf(out, "%8ld %7ld %9.3fs %9.3fs %9.3fs %11lld %11ld  %s\n",
+
+                      t->calls, t->failed, t->real, t->user, t->sys, t->rss_sum / t->calls, t->rss_max, t->name);
+
+        free(t->name);
+
+        free(t);
+
+    }
+
+    if (bad > 0) fprintf(stderr, "sa: %s: skipped %ld malformed lines\n", path, bad);
+
+
+
+    free(all);
+
+    arena_free(&line);
+
+    free(in.buf);
+
+    if (in.fd >= 0) close(in.fd);
+
+    if (in.fd < 0 && in.len > 0) munmap((void *)in.data, in.len);
+
+    free(path);
+
+    return 0;
+
+}
+
+
+
+// One command started by "parallel"
+
+struct task {
+
+    struct job *job;     // Job table entry, filled in by the shell's normal reaping
+
+    int fd;              // Read end of the task's output pipe with -k, else -1
+
+    char *buf;           // Output held back until it's this task's turn (-k)
+
+    size_t len, cap;
+
+    long long start;     // Start time in ns
+
+    int finished;        // Process reaped and pipe drained
+
+    struct mux_stream *stream;  // Tagged output stream with "tagout on" (without -k)
+
+};
+
+
+
+// Function to build one command from the template: "{}" is replaced by the input line,
+
+// and the line becomes the last argument if the template has no "{}"
+
+char **build_task_args(char **tmpl, const char *line) {
+
+    int n = 0;
+
+    int has_slot = 0;
+
+    while (tmpl[n] != NULL) {
+
+        if (strstr(tmpl[n], "{}") != NULL) has_slot = 1;
+
+        n++;
+
+    }
+
+    char **argv = calloc(n + 2, sizeof(char *));
+
+    for (int i = 0; i < n; i++) {
+
+        const char *slot = strstr(tmpl[i], "{}");
+
+        if (slot == NULL) {
+
+            argv[i] = strdup(tmpl[i]);
+
+            continue;
+
+        }
+
+        // Replace every "{}" in this argument
+
+        size_t count = 0;
+
+        for (const char *c = slot; (c = strstr(c, "{}")) != NULL; c += 2) count++;
+
+        size_t size = strlen(tmpl[i]) + count * strlen(line) + 1;
+
+        char *arg = malloc(size);
+
+        char *dst = arg;
+
+        for (const char *src = tmpl[i]; *src != '\0'; ) {
+
+            if (src[0] == '{' && src[1] == '}') {
+
+                dst = stpcpy(dst, line);
+
+                src += 2;
+
+            } else {
+
+                *dst++ = *src++;
+
+            }
+
+        }
+
+        *dst = '\0';
+
+        argv[i] = arg;
+
+    }
+
+    if (!has_slot) argv[n++] = strdup(line);
+
+    argv[n] = NULL;
+
+    return argv;
+
+}
+
+
+
+// Function to free an argument list made by build_task_args()
+
+void free_task_args(char **argv) {
+
+    for (int i = 0; argv[i] != NULL; i++) free(argv[i]);
+
+    free(argv);
+
+}
+
+
+
+// Built-in "parallel": run a command template once per input line, up to N at a time
+
+// Usage: parallel [-j N] [-k] [-v] [-a file] command [args with {}]...
+
+//   -j N     at most N children at once (default: number of CPUs)
+
+//   -k       print each job's output whole and in input order
+
+//   -v       print a line per job (exit status, time, argument) to stderr
+
+//   -a file  read argument lines from file instead of stdin
+
+int builtin_parallel(char **args, struct writer *out) {
+
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+
+    int keep_order = 0;
+
+    int verbose = 0;
+
+    const char *arg_file = NULL;
+
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-'; i++) {
+
+        if (strcmp(args[i], "-j") == 0 && args[i + 1] != NULL) jobs = atol(args[++i]);
+
+        else if (strcmp(args[i], "-k") == 0) keep_order = 1;
+
+        else if (strcmp(args[i], "-v") == 0) verbose = 1;
+
+        else if (strcmp(args[i], "-a") == 0 && args[i + 1] != NULL) arg_file = args[++i];
+
+        else break;
+
+    }
+
+    char **tmpl = &args[i];
+
+    if (tmpl[0] == NULL || jobs < 1) {
+
+        fprintf(stderr, "usage: parallel [-j N] [-k] [-v] [-a file] command [args with {}]...\n");
+
+        return 2;
+
+    }
+
+    size_t *active = malloc(sizeof(size_t) * jobs);  // Indexes of the tasks still running
+
+    // What the pool waits on: every running task's pipe, plus the SIGCHLD signalfd and the multiplexer
+
+    struct pollfd *fds = malloc(sizeof(struct pollfd) * (jobs + 2));
+
+    size_t *owner = malloc(sizeof(size_t) * (jobs + 2));
+
+    if (active == NULL || fds == NULL || owner == NULL) {
+
+        perror("parallel");
+
+        free(active);
+
+        free(fds);
+
+        free(owner);
+
+        return 1;
+
+    }
+
+
+
+    // Argument lines come through the same block reader the shell uses for scripts
+
+    struct input in = {0};
+
+    struct arena line = {0};
+
+    in.fd = STDIN_FILENO;
+
+    if (arg_file != NULL && open_script(&in, arg_file) != 0) return 1;
+
+
+
+    // Children must not eat the argument lines when those come from our stdin
+
+    int null_fd = -1;
+
+    if (arg_file == NULL) null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+
+
+    struct task *tasks = NULL;         // Every task started, in input order
+
+    long long *times = NULL;           // Duration of each finished task, for the stats
+
+    size_t ntasks = 0, cap = 0;
+
+    size_t next_out = 0;               // -k: first task whose output hasn't been fully printed
+
+    long running = 0;
+
+    int more_input = 1;
+
+    int failed = 0;
+
+    int status = 0;
+
+    int out_of_memory = 0;
+
+    long long wall_start = now_ns();
+
+
+
+    while (more_input || running > 0) {
+
+        // Keep the pool full
+
+        while (more_input && running < jobs) {
+
+            arena_reset(&line);
+
+            char *text = next_line(&in, &line);
+
+            if (text == NULL) {
+
+                more_input = 0;
+
+                break;
+
+            }
+
+            if (ntasks == cap) {
+
+                size_t new_cap = cap ? cap * 2 : 64;
+
+                struct task *grown = realloc(tasks, new_cap * sizeof(struct task));
+
+                if (grown != NULL) tasks = grown;
+
+                long long *grown_times = grown != NULL ? realloc(times, new_cap * sizeof(long long)) : NULL;
+
+                if (grown_times != NULL) times = grown_times;
+
+                if (grown_times == NULL) {
+
+                    // Start nothing more, the tasks already running still finish and get printed
+
+                    perror("parallel");
+
+                    out_of_memory = 1;
+
+                    more_input = 0;
+
+                    break;
+
+                }
+
+                cap = new_cap;
+
+            }
+
+            struct task *t = &tasks[ntasks];
+
+            memset(t, 0, sizeof(*t));
+
+            t->fd = -1;
+
+
+
+            int pipefd[2] = {-1, -1};
+
+            if (keep_order && pipe2(pipefd, O_CLOEXEC) == 0) {
+
+                fcntl(pipefd[0], F_SETFL, O_NONBLOCK);
+
+                t->fd = pipefd[0];
+
+            }
+
+            struct child_io io = {null_fd, pipefd[1], -1, -1, NULL, 0};
+
+            if (!keep_order && tag_output) {
+
+                // Each line of output goes out whole, tagged with the task's number
+
+                char tag[32];
+
+                snprintf(tag, sizeof(tag), "[#%zu] ", ntasks + 1);
+
+                io.out = io.err = mux_open(tag, 1, &t->stream);
+
+                pipefd[1] = io.out;
+
+            }
+
+            char **argv = build_task_args(tmpl, text);
+
+            t->job = new_job(text, 0);
+
+            t->start = now_ns();
+
+            pid_t pid = launch_command(argv, spawn_backend, &io);
+
+            if (pipefd[1] >= 0) close(pipefd[1]);  // Only the child writes, so EOF comes when it exits
+
+            if (pid > 0) {
+
+                job_add_process(t->job, pid, argv[0]);
+
+                t->job->last_pid = pid;
+
+                active[running++] = ntasks;
+
+            } else {
+
+                // Couldn't start: counts as a failed job with status 127
+
+                if (t->fd >= 0) close(t->fd);
+
+                t->fd = -1;
+
+                if (t->stream != NULL) mux_release(t->stream);
+
+                t->finished = 1;
+
+                times[ntasks] = 0;
+
+                failed++;
+
+                status = 127;
+
+                free_job(t->job);
+
+                t->job = NULL;
+
+            }
+
+            free_task_args(argv);
+
+            ntasks++;
+
+        }
+
+
+
+        // Wait for a child to exit or for output from any of them
+
+        if (running > 0) {
+
+            int nfds = 0;
+
+            if (sigchld_fd >= 0) {
+
+                fds[nfds].fd = sigchld_fd;
+
+                fds[nfds].events = POLLIN;
+
+                nfds++;
+
+            }
+
+            if (mux_epfd >= 0) {
+
+                fds[nfds].fd = mux_epfd;
+
+                fds[nfds].events = POLLIN;
+
+                nfds++;
+
+            }
+
+            for (long a = 0; a < running; a++) {
+
+                size_t k = active[a];
+
+                if (tasks[k].fd < 0) continue;
+
+                fds[nfds].fd = tasks[k].fd;
+
+                fds[nfds].events = POLLIN;
+
+                owner[nfds] = k;
+
+                nfds++;
+
+            }
+
+            // Without a signalfd, fall back to checking for exits every 10ms
+
+            if (poll(fds, nfds, sigchld_fd >= 0 ? -1 : 10) < 0 && errno != EINTR) perror("poll failed");
+
+
+
+            for (int f = 0; f < nfds; f++) {
+
+                if (fds[f].fd == sigchld_fd || fds[f].revents == 0) continue;
+
+                if (fds[f].fd == mux_epfd) {
+
+                    mux_drain(0);
+
+                    continue;
+
+                }
+
+                struct task *t = &tasks[owner[f]];
+
+                char chunk[PIPE_CHUNK];
+
+                ssize_t n;
+
+                while ((n = read(t->fd, chunk, sizeof(chunk))) > 0) {
+
+                    if (owner[f] == next_out) {
+
+                        // Head of the queue: its output can go out as it arrives
+
+                        writer_put(out, chunk, n);
+
+                        continue;
+
+                    }
+
+                    if (t->len + n > t->cap) {
+
+                        size_t task_cap = (t->len + n) * 2;
+
+                        char *buf = realloc(t->buf, task_cap);
+
+                        if (buf == NULL) {
+
+                            // Can't hold it back: out of order is better than lost
+
+                            if (!out_of_memory) perror("parallel");
+
+                            out_of_memory = 1;
+
+                            writer_put(out, chunk, n);
+
+                            continue;
+
+                        }
+
+                        t->buf = buf;
+
+                        t->cap = task_cap;
+
+                    }
+
+                    memcpy(t->buf + t->len, chunk, n);
+
+                    t->len += n;
+
+                }
+
+                if (n == 0) {
+
+                    close(t->fd);
+
+                    t->fd = -1;
+
+                }
+
+            }
+
+            reap_children();
+
+        }
+
+
+
+        // Collect finished tasks, only the running ones need looking at
+
+        for (long a = 0; a < running; ) {
+
+            size_t k = active[a];
+
+            struct task *t = &tasks[k];
+
+            if (t->job->state != JOB_DONE || t->fd >= 0 || (t->stream != NULL && t->stream->fd >= 0)) {
+
+                a++;
+
+                continue;
+
+            }
+
+            active[a] = active[--running];  // Swap-remove, order of the active list doesn't matter
+
+            if (t->stream != NULL) mux_release(t->stream);
+
+            t->finished = 1;
+
+            times[k] = now_ns() - t->start;
+
+            if (t->job->status != 0) failed++;
+
+            status = t->job->status != 0 ? t->job->status : status;
+
+            if (verbose) {
+
+                fprintf(stderr, "parallel: job %zu exit %d %.3fs: %s\n",
+
+                        k + 1, t->job->status, times[k] / 1e9, t->job->command);
+
+            }
+
+            free_job(t->job);
+
+            t->job = NULL;
+
+        }
+
+
+
+        // -k: print whole outputs in input order
+
+        while (keep_order && next_out < ntasks && tasks[next_out].finished) {
+
+            writer_put(out, tasks[next_out].buf, tasks[next_out].len);
+
+            free(tasks[next_out].buf);
+
+            tasks[next_out].buf = NULL;
+
+            next_out++;
+
+            // The new head may have buffered output already, send it now and stream the rest
+
+            if (next_out < ntasks && !tasks[next_out].finished) {
+
+                writer_put(out, tasks[next_out].buf, tasks[next_out].len);
+
+                tasks[next_out].len = 0;
+
+            }
+
+        }
+
+        writer_flush(out);
+
+    }
+
+
+
+    // Summary line: wall time and per-job time distribution
+
+    long long wall = now_ns() - wall_start;
+
+    if (ntasks > 0) {
+
+        qsort(times, ntasks, sizeof(long long), compare_samples);
+
+        fprintf(stderr, "parallel: %zu jobs, %d failed, -j %ld, wall %.3fs, job min %.3fs median %.3fs max %.3fs\n",
+
+                ntasks, failed, jobs, wall / 1e9, times[0] / 1e9, times[ntasks / 2] / 1e9, times[ntasks - 1] / 1e9);
+
+    }
+
+
+
+    for (size_t k = 0; k < ntasks; k++) free(tasks[k].buf);
+
+    free(tasks);
+
+    free(active);
+
+    free(fds);
+
+    free(owner);
+
+    free(times);
+
+    arena_free(&line);
+
+    free(in.buf);
+
+    if (arg_file != NULL && in.fd >= 0) close(in.fd);
+
+    if (arg_file != NULL && in.fd < 0 && in.len > 0) munmap((void *)in.data, in.len);
+
+    if (null_fd >= 0) close(null_fd);
+
+    return out_of_memory ? 1 : status;
+
+}
+
+
+
+// COMMAND CACHE
+
+// "cache command args..." runs the command once and keeps its stdout and exit status on disk.
+
+// Later runs with the same key print the stored output without starting anything. Entries are
+
+// files named after a hash of the key, and each one starts with the key so a collision is never a hit.
+
+// Layout: [int32 status][u32 key length][key][stdout]
+
+
+
+// Function to find (and create) the cache directory: $MYSHELL_CACHE, else $XDG_CACHE_HOME/myshell,
+
+// else ~/.cache/myshell. Returns a malloc()ed path or NULL
+
+char *cache_dir(void) {
+
+    char buf[4096];
+
+    const char *dir = getenv("MYSHELL_CACHE");
+
+    if (dir == NULL) {
+
+        const char *base = getenv("XDG_CACHE_HOME");
+
+        if (base != NULL) {
+
+            snprintf(buf, sizeof(buf), "%s/myshell", base);
+
+        } else {
+
+            const char *home = getenv("HOME");
+
+            snprintf(buf, sizeof(buf), "%s/.cache", home != NULL ? home : ".");
+
+            mkdir(buf, 0700);
+
+            strncat(buf, "/myshell", sizeof(buf) - strlen(buf) - 1);
+
+        }
+
+        dir = buf;
+
+    }
+
+    if (mkdir(dir, 0700) != 0 && errno != EEXIST) {
+
+        fprintf(stderr, "cache: %s: %s\n", dir, strerror(errno));
+
+        return NULL;
+
+    }
+
+    return strdup(dir);
+
+}
+
+
+
+// Function to hash the key into a file name: two 64-bit FNV-1a passes with different seeds
+
+void cache_name(const struct strbuf *key, char name[33]) {
+
+    uint64_t h1 = 14695981039346656037ull;
+
+    uint64_t h2 = 0x6a09e667f3bcc909ull;
+
+    for (size_t i = 0; i < key->len; i++) {
+
+        h1 = (h1 ^ (unsigned char)key->data[i]) * 1099511628211ull;
+
+        h2 = (h2 ^ (unsigned char)key->data[i]) * 0x100000001b3ull;
+
+        h2 ^= h2 >> 29;
+
+    }
+
+    snprintf(name, 33, "%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+
+}
+
+
+
+// Function to print a stored entry if it is there, fresh and really for this key
+
+// Returns the stored exit status, or -1 for a miss
+
+int cache_lookup(const char *path, const struct strbuf *key, long ttl, struct writer *out) {
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) return -1;
+
+    struct stat st;
+
+    int32_t status;
+
+    uint32_t keylen;
+
+    char *stored = NULL;
+
+    int hit = fstat(fd, &st) == 0 &&
+
+              (ttl <= 0 || time(NULL) - st.st_mtime < ttl) &&  // The entry's age is its file's mtime
+
+              read(fd, &status, sizeof(status)) == sizeof(status) &&
+
+              read(fd, &keylen, sizeof(keylen)) == sizeof(keylen) &&
+
+              keylen == key->len &&
+
+              (stored = malloc(keylen + 1)) != NULL &&
+
+              read(fd, stored, keylen) == (ssize_t)keylen &&
+
+              memcmp(stored, key->data, keylen) == 0;
+
+    free(stored);
+
+    if (!hit) {
+
+        close(fd);
+
+        return -1;
+
+    }
+
+    writer_flush(out);
+
+    char chunk[PIPE_CHUNK];
+
+    ssize_t n;
+
+    while ((n = read(fd, chunk, sizeof(chunk))) > 0) writer_put(out, chunk, n);
+
+    close(fd);
+
+    return status;
+
+}
+
+
+
+// Function to remove every entry in the cache directory
+
+int cache_clear(const char *dir) {
+
+    DIR *d = opendir(dir);
+
+    if (d == NULL) {
+
+        fprintf(stderr, "cache: %s: %s\n", dir, strerror(errno));
+
+        return 1;
+
+    }
+
+    struct dirent *e;
+
+    while ((e = readdir(d)) != NULL) {
+
+        if (e->d_name[0] != '.' || strncmp(e->d_name, ".tmp.", 5) == 0) unlinkat(dirfd(d), e->d_name, 0);
+
+    }
+
+    closedir(d);
+
+    return 0;
+
+}
+
+
+
+// Built-in "cache": memoize the output of a command that always prints the same thing for the same input
+
+// Usage: cache [-t seconds] [-e VAR]... [-f file]... command [args...]
+
+//        cache -r [-e VAR]... [-f file]... command [args...]   forget that entry
+
+//        cache -r                                             forget everything
+
+// The key is the arguments, the current directory, the -e variables and the size and mtime of the -f files.
+
+// -t makes entries older than that many seconds count as missing. Killed commands aren't stored.
+
+int builtin_cache(char **args, struct writer *out) {
+
+    const char *usage = "usage: cache [-t seconds] [-e VAR]... [-f file]... command [args...] | cache -r\n";
+
+    long ttl = 0;
+
+    int remove = 0;
+
+    int bad_option = 0;
+
+    struct strbuf key = {0};
+
+    char stamp[64];
+
+    int i = 1;
+
+    for (; args[i] != NULL && args[i][0] == '-'; i++) {
+
+        if ((strcmp(args[i], "-t") == 0 || strcmp(args[i], "-e") == 0 || strcmp(args[i], "-f") == 0) &&
+
+            args[i + 1] == NULL) {
+
+            bad_option = 1;  // The value is missing, don't run the option as the command
+
+            break;
+
+        } else if (strcmp(args[i], "-t") == 0) {
+
+            char *end;
+
+            ttl = strtol(args[++i], &end, 10);
+
+            if (end == args[i] || *end != '\0' || ttl < 1) {
+
+                bad_option = 1;  // 0 would mean entries never expire
+
+                break;
+
+            }
+
+        } else if (strcmp(args[i], "-r") == 0) {
+
+            remove = 1;
+
+        } else if (strcmp(args[i], "-e") == 0 && args[i + 1] != NULL) {
+
+            const char *name = args[++i];
+
+            const char *value = getenv(name);
+
+            strbuf_put(&key, "env ", 4);
+
+            strbuf_put(&key, name, strlen(name) + 1);
+
+            if (value != NULL) strbuf_put(&key, value, strlen(value) + 1);
+
+            else strbuf_put(&key, "\0unset", 7);  // Unset and empty are different keys
+
+        } else if (strcmp(args[i], "-f") == 0 && args[i + 1] != NULL) {
+
+            const char *file = args[++i];
+
+            struct stat st;
+
+            if (stat(file, &st) == 0) {
+
+                snprintf(stamp, sizeof(stamp), "%lld.%09ld %lld", (long long)st.st_mtim.tv_sec,
+
+                         (long)st.st_mtim.tv_nsec, (long long)st.st_size);
+
+            } else {
+
+                snprintf(stamp, sizeof(stamp), "missing");
+
+            }
+
+            strbuf_put(&key, "file ", 5);
+
+            strbuf_put(&key, file, strlen(file) + 1);
+
+            strbuf_put(&key, stamp, strlen(stamp) + 1);
+
+        } else {
+
+            break;
+
+        }
+
+    }
+
+    if (bad_option) {
+
+        fprintf(stderr, "%s", usage);
+
+        free(key.data);
+
+        return 2;
+
+    }
+
+    char **cmd = &args[i];
+
+    char *dir = cache_dir();
+
+    if (dir == NULL) {
+
+        free(key.data);
+
+        return 1;
+
+    }
+
+    if (cmd[0] == NULL) {
+
+        int status = 2;
+
+        if (remove) status = cache_clear(dir);
+
+        else fprintf(stderr, "%s", usage);
+
+        free(key.data);
+
+        free(dir);
+
+        return status;
+
+    }
+
+
+
+    char cwd[4096];
+
+    if (getcwd(cwd, sizeof(cwd)) == NULL) cwd[0] = '\0';
+
+    strbuf_put(&key, "cwd ", 4);
+
+    strbuf_put(&key, cwd, strlen(cwd) + 1);
+
+    strbuf_put(&key, "argv", 4);
+
+    for (int k = 0; cmd[k] != NULL; k++) strbuf_put(&key, cmd[k], strlen(cmd[k]) + 1);
+
+
+
+    char name[33];
+
+    cache_name(&key, name);
+
+    size_t dirlen = strlen(dir);
+
+    char *path = malloc(dirlen + sizeof(name) + 1);
+
+    if (path == NULL) {
+
+        perror("cache");
+
+        free(dir);
+
+        free(key.data);
+
+        return 1;
+
+    }
+
+    sprintf(path, "%s/%s", dir, name);
+
+
+
+    int status;
+
+    if (remove) {
+
+        status = unlink(path) == 0 || errno == ENOENT ? 0 : 1;
+
+    } else if ((status = cache_lookup(path, &key, ttl, out)) < 0) {
+
+        // Miss: the command writes straight into a new entry after its header, then it's renamed into place
+
+        char *tmp = malloc(dirlen + 32);
+
+        if (tmp == NULL) {
+
+            perror("cache");
+
+            free(path);
+
+            free(dir);
+
+            free(key.data);
+
+            return 1;
+
+        }
+
+        sprintf(tmp, "%s/.tmp.%d", dir, (int)getpid());
+
+        int fd = open(tmp, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+        int32_t pending = -1;
+
+        uint32_t keylen = key.len;
+
+        if (fd < 0 || write(fd, &pending, sizeof(pending)) != sizeof(pending) ||
+
+            write(fd, &keylen, sizeof(keylen)) != sizeof(keylen) ||
+
+            write(fd, key.data, key.len) != (ssize_t)key.len) {
+
+            fprintf(stderr, "cache: %s: %s\n", tmp, strerror(errno));
+
+            if (fd >= 0) close(fd);
+
+            unlink(tmp);
+
+            free(tmp);
+
+            free(path);
+
+            free(dir);
+
+            free(key.data);
+
+            return 1;
+
+        }
+
+        off_t header = lseek(fd, 0, SEEK_CUR);
+
+
+
+        // The command runs as a normal foreground job, only its stdout is the entry file
+
+        struct strbuf text = {0};
+
+        for (int k = 0; cmd[k] != NULL; k++) {
+
+            if (k > 0) strbuf_put(&text, " ", 1);
+
+            strbuf_put(&text, cmd[k], strlen(cmd[k]));
+
+        }
+
+        struct job *job = new_job(text.data, 0);
+
+        free(text.data);
+
+        struct child_io io = {-1, fd, -1, job_control ? 0 : -1, NULL, 0};
+
+        pid_t pid = launch_command(cmd, spawn_backend, &io);
+
+        if (pid > 0) {
+
+            job_add_process(job, pid, cmd[0]);
+
+            job->last_pid = pid;
+
+            status = wait_for_job(job, 1);
+
+        } else {
+
+            status = 127;
+
+        }
+
+        if (job->state == JOB_DONE) free_job(job);
+
+
+
+        if (pid > 0 && status < 128) {
+
+            int32_t stored = status;
+
+            pwrite(fd, &stored, sizeof(stored), 0);
+
+            if (rename(tmp, path) != 0) fprintf(stderr, "cache: %s: %s\n", path, strerror(errno));
+
+        } else {
+
+            unlink(tmp);
+
+        }
+
+
+
+        // Now show the user what the command printed
+
+        writer_flush(out);
+
+        char chunk[PIPE_CHUNK];
+
+        ssize_t n;
+
+        off_t pos = header;
+
+        while ((n = pread(fd, chunk, sizeof(chunk), pos)) > 0) {
+
+            writer_put(out, chunk, n);
+
+            pos += n;
+
+        }
+
+        close(fd);
+
+        free(tmp);
+
+    }
+
+    free(path);
+
+    free(dir);
+
+    free(key.data);
+
+    return status;
+
+}
+
+
+
+// Table of built-in commands, checked before anything is spawned
+
+struct builtin {
+
+    const char *name;
+
+    int (*run)(char **args, struct writer *out);  // Returns the exit status
+
+};
+
+
+
+const struct builtin builtins[] = {
+
+    {"acct", builtin_acct},
+
+    {"bg", builtin_bg},
+
+    {"cache", builtin_cache},
+
+    {"cd", builtin_cd},
+
+    {"echo", builtin_echo},
+
+    {"exit", builtin_exit},
+
+    {"export", builtin_export},
+
+    {"false", builtin_false},
+
+    {"fastpipe", builtin_fastpipe},
+
+    {"fg", builtin_fg},
+
+    {"hash", builtin_hash},
+
+    {"history", builtin_history},
+
+    {"jobs", builtin_jobs},
+
+    {"parallel", builtin_parallel},
+
+    {"pwd", builtin_pwd},
+
+    {"sa", builtin_sa},
+
+    {"spawnbench", builtin_spawnbench},
+
+    {"spawnmode", builtin_spawnmode},
+
+    {"tagout", builtin_tagout},
+
+    {"test", builtin_test},
+
+    {"true", builtin_true},
+
+    {"wait", builtin_wait},
+
+    {"[", builtin_test},
+
+};
+
+
+
+// Function to find a built-in by name, NULL if the command isn't one
+
+const struct builtin *find_builtin(const char *name) {
+
+    for (size_t i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+
+        if (strcmp(builtins[i].name, name) == 0) return &builtins[i];
+
+    }
+
+    return NULL;
+
+}
+
+
+
+// Function to run a built-in with its output going to fd, returns its exit status
+
+int run_builtin(const struct builtin *b, char **args, int fd) {
+
+    static struct writer out;  // Static: too big for the stack of every call, and built-ins never nest
+
+    out.fd = fd;
+
+    out.len = 0;
+
+    int status = b->run(args, &out);
+
+    writer_flush(&out);
+
+    return status;
+
+}
+
+
+
+// Function to run an N-stage pipeline as one job: every stage is started before any is waited for
+
+// ios[] holds each stage's redirections, the pipe ends and process group are filled in here
+
+// usage, when not NULL, gets the resources used by all the stages of a foreground job
+
+// Returns the exit status of the last stage, or 0 straight away for a background job
+
+int execute_pipeline(char ***stages, struct child_io *ios, int nstages, int background, const char *text,
+
+                     struct rusage *usage) {
+
+    int (*pipes)[2] = malloc(sizeof(int[2]) * (nstages > 1 ? nstages - 1 : 1));
+
+    if (pipes == NULL) {
+
+        perror("pipeline");
+
+        return 1;
+
+    }
+
+
+
+    // Create all the pipes up front, O_CLOEXEC so a child only keeps the two ends it dup2()s
+
+    int npipes = 0;
+
+    for (; npipes < nstages - 1; npipes++) {
+
+        if (pipe2(pipes[npipes], O_CLOEXEC) < 0) {
+
+            perror("pipe2 failed");
+
+            break;
+
+        }
+
+    }
+
+
+
+    struct job *job = new_job(text, background);
 
-#include <string.h>    // For string manipulation functions like strtok()
+    // With "tagout on" a background job prints through the multiplexer: stdout of the last stage
 
-#include <unistd.h>    // For system calls like fork(), execvp(), and getpid()
+    // and stderr of all of them go into one pipe the shell reads
 
-#include <sys/wait.h>  // For wait() to make the parent wait for child process completion
+    int tagfd = -1;
 
+    if (background && tag_output) {
 
+        char tag[32];
 
-// Define constants for command length and the number of arguments
+        snprintf(tag, sizeof(tag), "[%d] ", job->id);
 
-#define MAX_COMMAND_LENGTH 1024  // Maximum length of a single command
+        tagfd = mux_open(tag, 0, NULL);
 
-#define MAX_ARGS 100             // Maximum number of arguments a command can have
+    }
 
+    if (npipes == nstages - 1) {
 
+        for (int i = 0; i < nstages; i++) {
 
-// Function to read a command from the user
+            struct child_io *io = &ios[i];
 
-void read_command(char *command) {
+            io->in = (i > 0) ? pipes[i - 1][0] : -1;
+
+            io->out = (i < nstages - 1) ? pipes[i][1] : tagfd;
+
+            io->err = tagfd;
+
+            io->pgid = job_control ? job->pgid : -1;
+
+
+
+            pid_t pid;
+
+            int empty = stages[i][0] == NULL;  // Only redirections, e.g. "> file | cat"
+
+            const struct builtin *b = empty ? NULL : find_builtin(stages[i][0]);
+
+            if (empty || (nstages > 1 && is_stage_builtin(stages[i])) || b != NULL) {
+
+                // Built-in stages still need their own process so all stages run at the same time
+
+                fflush(stdout);  // Don't let the child inherit (and print) a half-full stdio buffer
+
+                pid = fork();
+
+                if (pid == 0) {
+
+                    if (io->pgid >= 0) setpgid(0, io->pgid);
+
+                    job_control = 0;  // The terminal belongs to this whole pipeline, not to jobs the stage starts
+
+                    reset_child_signals();
+
+                    // Still the shell's code though: built-ins like parallel reap through the signalfd
+
+                    sigset_t chld;
+
+                    sigemptyset(&chld);
+
+                    sigaddset(&chld, SIGCHLD);
+
+                    sigprocmask(SIG_BLOCK, &chld, NULL);
+
+                    mux_forget();
+
+                    if (io->in >= 0) dup2(io->in, STDIN_FILENO);
+
+                    if (io->out >= 0) dup2(io->out, STDOUT_FILENO);
+
+                    if (io->err >= 0) dup2(io->err, STDERR_FILENO);
+
+                    // fork() ignores O_CLOEXEC, close every pipe end or the next stage never sees EOF
+
+                    for (int p = 0; p < npipes; p++) {
+
+                        close(pipes[p][0]);
+
+                        close(pipes[p][1]);
+
+                    }
+
+                    if (apply_redirects(io) != 0) _exit(1);
+
+                    int status;
+
+                    if (empty) status = 0;
+
+                    else if (b != NULL) status = run_builtin(b, stages[i], STDOUT_FILENO);
+
+                    else if (strcmp(stages[i][0], "cat") == 0) status = stage_cat(stages[i]);
+
+                    else status = stage_tee(stages[i]);
+
+                    _exit(status);
+
+                } else if (pid < 0) {
+
+                    perror("Fork failed");
+
+                } else if (io->pgid >= 0) {
+
+                    setpgid(pid, io->pgid ? io->pgid : pid);
+
+                }
+
+            } else {
+
+                pid = launch_command(stages[i], spawn_backend, io);
+
+            }
+
+            if (pid > 0) job_add_process(job, pid, empty ? "" : stages[i][0]);
+
+            if (i == nstages - 1) job->last_pid = pid;
+
+        }
+
+    }
+
+
+
+    // The shell must drop its copies of the pipe ends too, otherwise readers wait forever
+
+    for (int p = 0; p < npipes; p++) {
+
+        close(pipes[p][0]);
+
+        close(pipes[p][1]);
+
+    }
+
+    if (tagfd >= 0) close(tagfd);  // The stream sees end of file once the job's processes have exited
 
-    printf("myShell> ");  // Display shell prompt
 
-    if (fgets(command, MAX_COMMAND_LENGTH, stdin) == NULL) {
 
-        perror("Error reading command");  // Handle input error
+    free(pipes);
 
-        exit(1);  // Exit with failure status
+
+
+    if (job->nprocs == 0) {
+
+        free_job(job);
+
+        return 127;
+
+    }
+
+    if (background) {
+
+        // Don't wait: the job is reaped later from the SIGCHLD event loop
+
+        if (job_control) fprintf(stderr, "[%d] %d\n", job->id, (int)job->pgid);
+
+        return 0;
 
     }
 
-    // Remove the trailing newline character added by fgets
 
-    command[strcspn(command, "\n")] = '\0';
+
+    // Wait for the whole group, the pipeline's status is the last stage's
+
+    int status = wait_for_job(job, 1);
+
+    if (usage != NULL) *usage = job->usage;
+
+    if (job->state == JOB_DONE) free_job(job);
+
+    return status;
+
+}
+
+
+
+// Function to add what getrusage(who) has gained since before to total
+
+void usage_since(const struct rusage *before, int who, struct rusage *total) {
+
+    struct rusage now;
+
+    getrusage(who, &now);
+
+    timersub(&now.ru_utime, &before->ru_utime, &now.ru_utime);
+
+    timersub(&now.ru_stime, &before->ru_stime, &now.ru_stime);
+
+    now.ru_nvcsw -= before->ru_nvcsw;
+
+    now.ru_nivcsw -= before->ru_nivcsw;
+
+    add_usage(total, &now);  // ru_maxrss stays a peak, there is no "since" for it
+
+}
+
+
+
+// Function to print the "time" report for a pipeline to stderr
+
+void print_usage(long long wall_ns, const struct rusage *ru) {
+
+    fprintf(stderr, "\nreal\t%.3fs\nuser\t%ld.%03lds\nsys\t%ld.%03lds\nmaxrss\t%ld KB\nctxsw\t%ld voluntary, %ld involuntary\n",
+
+            wall_ns / 1e9,
+
+            (long)ru->ru_utime.tv_sec, (long)ru->ru_utime.tv_usec / 1000,
+
+            (long)ru->ru_stime.tv_sec, (long)ru->ru_stime.tv_usec / 1000,
+
+            ru->ru_maxrss, ru->ru_nvcsw, ru->ru_nivcsw);
 
 }
 
 
 
-// Function to parse the command into arguments
+// Function to run one pipeline from the command tree, returns its exit status
+
+// Words are expanded and redirected files opened here, right before running
+
+int run_pipeline(const struct pipeline *p, int background, const char *text, struct arena *a) {
+
+    char ***stages = arena_alloc(a, p->nstages * sizeof(char **));
+
+    struct child_io *ios = arena_alloc(a, p->nstages * sizeof(struct child_io));
+
+
+
+    // Files opened for redirections: the children get copies, the shell closes these afterwards
+
+    int nredirs = 0;
+
+    for (const struct command *c = p->stages; c != NULL; c = c->next) {
 
-void parse_command(char *command, char **args) {
+        for (const struct redirect *r = c->redirs; r != NULL; r = r->next) nredirs++;
+
+    }
+
+    int *opened = arena_alloc(a, nredirs * sizeof(int));
+
+    int nopened = 0;
+
+
+
+    int status = 0;
+
+    long long start = now_ns();
+
+    struct rusage usage = {0};
 
     int i = 0;
 
-    // Use strtok to split the command string by spaces
+    for (const struct command *c = p->stages; c != NULL; c = c->next, i++) {
 
-    args[i] = strtok(command, " ");
+        stages[i] = expand_command(c, a);
 
-    while (args[i] != NULL) {
+        if (open_redirects(c, a, &ios[i], opened, &nopened) != 0) {
+
+            status = 1;
+
+            goto done;
+
+        }
+
+    }
 
-        i++;
 
-        args[i] = strtok(NULL, " ");
+
+    // A lone command with only redirections just creates/truncates its files
+
+    if (p->nstages == 1 && stages[0][0] == NULL) goto done;
+
+
+
+    // Foreground built-ins run inside the shell: no fork, no exec
+
+    // Their redirections are applied to the shell's own fds for the duration of the call
+
+    const struct builtin *b = stages[0][0] != NULL ? find_builtin(stages[0][0]) : NULL;
+
+    if (p->nstages == 1 && !background && b != NULL) {
+
+        int *saved = arena_alloc(a, ios[0].nactions * sizeof(int));
+
+        if (redirect_shell_fds(&ios[0], saved) != 0) {
+
+            status = 1;
+
+            goto done;
+
+        }
+
+        struct rusage self, children;
+
+        getrusage(RUSAGE_SELF, &self);
+
+        getrusage(RUSAGE_CHILDREN, &children);
+
+        status = run_builtin(b, stages[0], STDOUT_FILENO);
+
+        restore_shell_fds(&ios[0], saved, ios[0].nactions);
+
+        // The shell's own usage plus any children the built-in reaped (parallel, wait)
+
+        usage_since(&self, RUSAGE_SELF, &usage);
+
+        usage_since(&children, RUSAGE_CHILDREN, &usage);
+
+        acct_write(stages[0][0], status, now_ns() - start, &usage);
+
+        goto done;
 
     }
 
+
+
+    // Everything else becomes a job
+
+    status = execute_pipeline(stages, ios, p->nstages, background, text, &usage);
+
+
+
+done:
+
+    for (int f = 0; f < nopened; f++) close(opened[f]);
+
+    if (p->timed && !background) print_usage(now_ns() - start, &usage);
+
+    return status;
+
 }
 
 
 
-// Function to execute the parsed command
+// Function to run an and-or list in the foreground, returns the status of the last pipeline that ran
+
+// "&&" runs the next pipeline only after success and "||" only after failure; skipped ones don't change
+
+// the status, so "false && a || b" runs b. Nothing is started for a skipped pipeline.
 
-void execute_command(char **args) {
+int execute_and_or(const struct and_or *item, struct arena *a) {
 
-    if (args[0] == NULL) return;  // No command entered, just return
+    int status = last_status;
 
+    for (const struct pipeline *p = item->pipelines; p != NULL; p = p->next) {
 
+        if (p->connector == CONNECT_AND && status != 0) continue;
 
-    // Handle built-in "exit" command
+        if (p->connector == CONNECT_OR && status == 0) continue;
 
-    if (strcmp(args[0], "exit") == 0) {
+        status = run_pipeline(p, 0, p->text, a);
 
-        exit(0);  // Terminate the shell
+        last_status = status;  // $? in the next pipeline is this one's status
 
     }
 
+    return status;
 
+}
 
-    // Create a new process using fork()
+
+
+// Function to run an and-or list like "make && ./test &" in the background
+
+// The list needs someone to wait between its pipelines, so a child copy of the shell runs it as one job
+
+void background_and_or(const struct and_or *item, struct arena *a) {
+
+    struct job *job = new_job(item->text, 1);
+
+    int tagfd = -1;
+
+    if (tag_output) {
+
+        char tag[32];
+
+        snprintf(tag, sizeof(tag), "[%d] ", job->id);
+
+        tagfd = mux_open(tag, 0, NULL);
+
+    }
+
+    fflush(stdout);
 
     pid_t pid = fork();
 
-    
+    if (pid == 0) {
 
-    if (pid < 0) {
+        // The copy isn't interactive: no terminal handoff, and the parent's jobs aren't its children
 
-        // Fork failed
+        if (job_control) setpgid(0, 0);
 
-        perror("Fork failed");
+        job_control = 0;
 
-    } else if (pid == 0) {
+        job_list = NULL;
+
+        mux_forget();
 
-        // Child process: execute the command
+        if (tagfd >= 0) {
 
-        if (execvp(args[0], args) == -1) {
+            // The whole list prints under this job's tag, its own pipelines don't tag again
 
-            perror("Command execution failed");  // Handle invalid commands
+            dup2(tagfd, STDOUT_FILENO);
+
+            dup2(tagfd, STDERR_FILENO);
+
+            close(tagfd);
+
+            tag_output = 0;
 
         }
 
-        exit(EXIT_FAILURE);  // Terminate child process if execvp fails
+        reset_child_signals();
 
-    } else {
+        sigset_t chld;
+
+        sigemptyset(&chld);
+
+        sigaddset(&chld, SIGCHLD);
+
+        sigprocmask(SIG_BLOCK, &chld, NULL);  // Still reaped through the signalfd
+
+        _exit(execute_and_or(item, a));
 
-        // Parent process: wait for child to complete
+    }
+
+    if (tagfd >= 0) close(tagfd);
+
+    if (pid < 0) {
+
+        perror("Fork failed");
+
+        free_job(job);
+
+        last_status = 1;
 
-        wait(NULL);
+        return;
 
     }
 
+    if (job_control) setpgid(pid, pid);
+
+    job_add_process(job, pid, "myShell");
+
+    job->last_pid = pid;
+
+    if (job_control) fprintf(stderr, "[%d] %d\n", job->id, (int)job->pgid);
+
+    last_status = 0;
+
 }
 
 
 
-int main() {
+// Function to execute the parsed command line: and-or lists one after another, separated by ";" or "&"
 
-    // Buffers for command and arguments
+void execute_command(struct and_or *list, struct arena *a) {
 
-    char command[MAX_COMMAND_LENGTH];  
+    dir_cache = NULL;  // Directories listed for globs are cached for this line only, in its arena
 
-    char *args[MAX_ARGS];
+    for (struct and_or *item = list; item != NULL; item = item->next) {
 
+        if (!item->background) execute_and_or(item, a);
 
+        else if (item->pipelines->next == NULL) last_status = run_pipeline(item->pipelines, 1, item->text, a);
 
-    // Infinite loop to keep the shell running
+        else background_and_or(item, a);
 
-    while (1) {
+    }
+
+}
+
+
+
+// Usage: myShell                interactive when stdin is a terminal, otherwise runs stdin as a script
+
+//        myShell script.sh      runs the file
+
+//        myShell -c 'commands'  runs the given string
+
+int main(int argc, char **argv) {
+
+    struct input in = {0};
+
+    struct arena arena = {0};
+
+
+
+    in.fd = STDIN_FILENO;
+
+    if (argc > 2 && strcmp(argv[1], "-c") == 0) {
+
+        in.fd = -1;
+
+        in.data = argv[2];
+
+        in.len = strlen(argv[2]);
 
-        read_command(command);        // Read user input
+    } else if (argc > 1) {
 
-        parse_command(command, args); // Parse the input into command and arguments
+        if (open_script(&in, argv[1]) != 0) return 127;
+
+    } else {
+
+        // Prompts only make sense when someone is typing
+
+        in.interactive = isatty(STDIN_FILENO);
+
+    }
+
+
+
+    // Children are reaped from an event loop instead of a signal handler:
+
+    // block SIGCHLD and read it from a signalfd that poll() can watch
+
+    sigset_t chld;
+
+    sigemptyset(&chld);
+
+    sigaddset(&chld, SIGCHLD);
+
+    sigprocmask(SIG_BLOCK, &chld, NULL);
+
+    sigchld_fd = signalfd(-1, &chld, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (sigchld_fd < 0) perror("signalfd failed");
 
-        execute_command(args);        // Execute the command
+
+
+    if (in.interactive) {
+
+        init_job_control();
+
+        history_open();
+
+    }
+
+
+
+    // Keep running until the input runs out
+
+    char *command;
+
+    while ((command = read_command(&in, &arena)) != NULL) {
+
+        if (in.interactive) history_add(command);
+
+        struct and_or *list = parse_command(command, &arena);  // Parse the line into a command tree
+
+        execute_command(list, &arena);                         // Run the commands in it
 
     }
 
 
 
-    return 0;  // Program never actually reaches this point
+    mux_drain(0);  // Tagged output that's already waiting in the pipes
+
+    if (in.interactive) printf("\n");  // Leave the terminal on a fresh line after Ctrl-D
+
+    return last_status;
 
 }
\ No newline at end of file
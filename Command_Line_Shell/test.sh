@@ -0,0 +1,50 @@
+#!/usr/bin/env bash
+# Regression tests for myShell: each case runs a script through the shell and compares its output.
+# Usage: ./test.sh [path/to/myShell]     (default: builds shell.c into a temporary directory)
+# Prints one line per failed case and exits with status 1 if any failed.
+set -eu
+
+here=$(cd "$(dirname "$0")" && pwd)
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+if [ $# -gt 0 ]; then
+    shell=$1
+else
+    ${CC:-cc} -O2 -o "$tmp/myShell" "$here/shell.c"
+    shell=$tmp/myShell
+fi
+
+failed=0
+
+# Run stdin as a script in $tmp and compare stdout with the expected text
+# Usage: check name expected [PATH]
+check() {
+    cat > "$tmp/case.sh"
+    local got
+    got=$(cd "$tmp" && PATH=${3:-$PATH} HISTFILE=$tmp/history "$shell" "$tmp/case.sh" 2>&1) || true
+    if [ "$got" != "$2" ]; then
+        printf 'FAIL %s\n  expected: %s\n  got:      %s\n' "$1" "$2" "$got"
+        failed=1
+    fi
+}
+
+# An unclosed ${ inside double quotes is literal and ends with the quotes
+check unclosed_brace_quoted '${foo a b c' <<'EOF_CASE'
+echo "${foo" a b c
+EOF_CASE
+
+# A command added to an earlier $PATH directory takes over from the cached one, even when another
+# lookup walked past that directory in between
+mkdir "$tmp/pa" "$tmp/pb"
+printf '#!/bin/sh\necho foo-b\n' > "$tmp/pb/foo"
+printf '#!/bin/sh\necho foo-a\n' > "$tmp/foo-a"
+chmod +x "$tmp/pb/foo" "$tmp/foo-a"
+check path_cache_earlier_dir "$(printf 'foo-b\nCommand execution failed: nosuchcmd: command not found\nfoo-a')" "$tmp/pa:$tmp/pb:$PATH" <<EOF_CASE
+foo
+cp $tmp/foo-a $tmp/pa/foo
+nosuchcmd
+foo
+EOF_CASE
+
+exit $failed
@@ -19,7 +19,7 @@ int j = 50;
 int toggle = 0;
 int wallhit = 0;
 
-void DuckMove(int x){
+void DuckMove(int x, int step){
 
 
     static int randY = 50;
@@ -43,16 +43,20 @@ void DuckMove(int x){
 				toggle = toggle + 1;
             }
             //putImage(j, i, 19, 13, Duck1Up, LeftRight, 0);
-            i++;
+            i += step;
             if(LeftRight == false){
-                j++;
-                if(j == x)
+                j += step;
+                if(j >= x){
+                    j = x;
                     LeftRight = true;
+                }
             }
             if(LeftRight == true){
-                j--;
-                if(j == 0)
+                j -= step;
+                if(j <= 0){
+                    j = 0; // Land exactly on 0 so the wallhit check still sees it
                     LeftRight = false;
+                }
             }
             if(i>=randY)
                 UpDown = false;
@@ -68,16 +72,20 @@ void DuckMove(int x){
 				toggle = toggle + 1;
             }
             //putImage(j, i, 19, 13, Duck1Up, LeftRight, 0);
-            i--;
+            i -= step;
             if(LeftRight == false){
-                j++;
-                if(j == x)
+                j += step;
+                if(j >= x){
+                    j = x;
                     LeftRight = true;
+                }
             }
             if(LeftRight == true){
-                j--;
-                if(j == 0)
+                j -= step;
+                if(j <= 0){
+                    j = 0; // Land exactly on 0 so the wallhit check still sees it
                     LeftRight = false;
+                }
             }
             if(i <= 20)
                 UpDown = true;
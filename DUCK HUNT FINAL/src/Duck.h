@@ -7,6 +7,6 @@
 #include <stdbool.h>
 
 extern const uint16_t Duck1Up[];
-void DuckMove(int x);
+void DuckMove(int x, int step);
 
 int RandMove(int min, int max);
\ No newline at end of file
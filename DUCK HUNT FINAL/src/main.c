@@ -7,6 +7,7 @@
 #include <time.h>
 #include "sound.h"
 #include "musical_notes.h"
+#include "waves.h"
 
 // FUNCTION DECLARATIONS 
 void initClock(void);              
@@ -53,6 +54,9 @@ void addHighScore(uint16_t newScore);
 void sortHighScores(void);         
 // Bubble sort - inefficient but only 10 elements so doesn't matter
 
+void spawnFrenzyDuck(int f);
+// Puts frenzy duck f at a random on-screen position with a random direction
+
 //  GLOBAL VARIABLES 
 
 volatile uint32_t milliseconds;    
@@ -73,6 +77,9 @@ uint8_t selectedTarget = 0;
 //  Stores which crosshair user chose (0=red, 1=blue, 2=purple, 3=pink)
 // uint8_t = 1 byte, only need 0-3 so wastes less RAM than uint16_t
 
+uint8_t selectedLevel = 0;         
+//  Difficulty chosen on the menu (0=EASY, 1=HARD), row of waveTable in waves.c
+
 // SPRITE DATA (UNUSED DECORATIONS REMOVED)
 
 const uint16_t TargetRed[]={
@@ -163,42 +170,52 @@ int duckHit = 0;
 // Without pause, duck teleports to new position instantly (looks glitchy)
 // Pause gives visual feedback that you actually hit it
 
+uint8_t waveIndex = 0;        
+//  Which wave of the selected level we are on, only moves forward as score grows
+
+const Wave *wave;             
+//  Pointer to current row of waveTable (in flash)
+// All difficulty numbers (speeds, frame time, frenzy settings) are read through this
+
 // FRENZY MODE SYSTEM 
 // frenzy: Makes game exciting at high scores, rewards skilled players
-// Triggers every 200 points, spawns 3 bonus ducks for 30 seconds
+// Trigger points, bonus duck count and length all come from the current wave
 
 int frenzyMode = 0;           
 //  Boolean - is frenzy currently active? (0=no, 1=yes)
 
 uint32_t frenzyEndTime = 0;   
 //  Absolute timestamp (in milliseconds) when frenzy should end
-// Set to: currentTime + 30000 when frenzy starts
+// Set to: currentTime + wave->frenzyLength when frenzy starts
 // Check: if (milliseconds >= frenzyEndTime) then end frenzy
 
 uint16_t lastFrenzyScore = 0; 
 //  Prevents re-triggering frenzy on same milestone
 // Without this: Hitting 200 points would trigger frenzy EVERY FRAME until score changes
-// With this: Check (score >= lastFrenzyScore + 200) only triggers once per 200-point milestone
+// With this: Check (score >= lastFrenzyScore + wave->frenzyEvery) only triggers once per milestone
 
-// Three bonus ducks during frenzy (simple independent movement kinda just bouncing around)
-int frenzyDuckActive[3] = {0, 0, 0}; 
-//  array of 3: Can have up to 3 bonus ducks alive simultaneously
+// Bonus ducks during frenzy (simple independent movement kinda just bouncing around)
+int frenzyDuckActive[MAX_FRENZY_DUCKS] = {0}; 
+//  Sized for the busiest wave, each wave uses the first wave->frenzyDucks slots
 // Each element: 0 = dead/not spawned, 1 = alive and should be drawn
 
-int frenzyDuckX[3];           
-//  X positions of 3 frenzy ducks (updated each frame)
+int frenzyDuckX[MAX_FRENZY_DUCKS];           
+//  X positions of frenzy ducks (updated each frame)
 
-int frenzyDuckY[3];           
-//  Y positions of 3 frenzy ducks
+int frenzyDuckY[MAX_FRENZY_DUCKS];           
+//  Y positions of frenzy ducks
 
-int frenzyDuckDirX[3];        
+int frenzyDuckDirX[MAX_FRENZY_DUCKS];        
 //  Horizontal velocities (-1 = moving left, +1 = moving right)
-// Multiplied by 2 each frame for actual movement speed
+// Multiplied by wave->frenzyStep each frame for actual movement speed
 
-int frenzyDuckDirY[3];        
+int frenzyDuckDirY[MAX_FRENZY_DUCKS];        
 //  Vertical velocities (-1 = moving up, +1 = moving down)
 // Flips when duck hits screen edge (simple bounce physics)
 
+uint32_t frenzyRespawnTime[MAX_FRENZY_DUCKS]; 
+//  When a shot frenzy duck comes back (0 = stays dead), only used if wave->respawnTime is set
+
 int main()
 {
 	//  INITIALIZE HARDWARE 
@@ -241,8 +258,12 @@ int main()
 		score = 0;              
 		lastFrenzyScore = 0;    
 		frenzyMode = 0;         
-		for (int f = 0; f < 3; f++) {
+		waveIndex = 0;          
+		wave = &waveTable[selectedLevel][0]; 
+		// Start at first wave of the level picked on the menu
+		for (int f = 0; f < MAX_FRENZY_DUCKS; f++) {
 			frenzyDuckActive[f] = 0; 
+			frenzyRespawnTime[f] = 0;
 			// Mark all frenzy ducks as dead so they don't appear at start
 		}
 	
@@ -289,9 +310,16 @@ int main()
 	// Set to 0 when UP+DOWN buttons pressed together aka let you return to menu
 	
 	//  INNER GAME LOOP 
-	//  Runs at ~20 FPS (50ms delay at end), handles all game logic each frame
+	//  Runs at a fixed frame time from the wave table (~17-25 FPS), handles all game logic each frame
 	while(gameRunning)
 	{
+		uint32_t frameStart = milliseconds; 
+		//  Frame is paced from here, so time spent drawing extra ducks comes out of the wait at the end
+
+		//  ADVANCE WAVE 
+		//  Table lookup instead of if/else per level: just compare score to the next row's start
+		waveIndex = waveForScore(selectedLevel, waveIndex, score);
+		wave = &waveTable[selectedLevel][waveIndex];
 
 		//To turn off leds depending on the amount of times the left side has been hit
 		switch(wallhit){
@@ -328,7 +356,8 @@ int main()
 			frenzyMode = 0; 
 			
 			// Clear all remaining frenzy ducks from screen
-			for (int f = 0; f < 3; f++) {
+			for (int f = 0; f < MAX_FRENZY_DUCKS; f++) {
+				frenzyRespawnTime[f] = 0; // Nothing comes back once frenzy is over
 				if (frenzyDuckActive[f]) {
 					fillRectangle(frenzyDuckX[f]-2, frenzyDuckY[f]-2, 23, 17, 0); 
 					// -2 and 23x17: Duck is 19x13, +2 padding ensures complete erase
@@ -382,8 +411,9 @@ int main()
 			// Without pause: Duck instantly teleports to new position (looks broken)
 			// With pause: Shows "HIT!" message, then duck respawns
 			
-			DuckMove(110); 
+			DuckMove(110, wave->duckStep); 
 			//  parameter 110: Tells DuckMove() the right screen boundary
+			// duckStep: Pixels per frame from the wave table, this is the speed curve
 			// Function in Duck.c handles diagonal bouncing with random Y targets
 		}
 		
@@ -391,7 +421,12 @@ int main()
 		if (frenzyMode) {
 			// only when active: Don't waste CPU checking inactive ducks
 			
-			for (int f = 0; f < 3; f++) {
+			for (int f = 0; f < MAX_FRENZY_DUCKS; f++) {
+				if (!frenzyDuckActive[f] && frenzyRespawnTime[f] && milliseconds >= frenzyRespawnTime[f]) {
+					//  Shot duck's respawn timer ran out (spawn rate comes from wave->respawnTime)
+					frenzyRespawnTime[f] = 0;
+					spawnFrenzyDuck(f);
+				}
 				if (frenzyDuckActive[f]) {
 					// check active: Duck might have been shot already
 					
@@ -399,10 +434,10 @@ int main()
 					// erase first: Remove duck from old position before moving
 					//  -2: Extra padding ensures clean erase even with rounding errors
 					
-					// Move duck 2 pixels in current direction
-					frenzyDuckX[f] += frenzyDuckDirX[f] * 2; 
-					frenzyDuckY[f] += frenzyDuckDirY[f] * 2;
-					//  *2: Speed multiplier (1 pixel/frame too slow, 2 is good)
+					// Move duck frenzyStep pixels in current direction
+					frenzyDuckX[f] += frenzyDuckDirX[f] * wave->frenzyStep; 
+					frenzyDuckY[f] += frenzyDuckDirY[f] * wave->frenzyStep;
+					//  frenzyStep: Speed multiplier from the wave table (2 on the first EASY wave)
 					
 					// Bounce off screen edges
 					if (frenzyDuckX[f] < 5 || frenzyDuckX[f] > 105) {
@@ -540,7 +575,7 @@ int main()
 			//  CHECK FRENZY DUCK COLLISIONS
 			//  only if missed main: Can only hit one duck per shot (prevents double-scoring)
 			if (!hitDetected && frenzyMode) {
-				for (int f = 0; f < 3; f++) {
+				for (int f = 0; f < MAX_FRENZY_DUCKS; f++) {
 					if (frenzyDuckActive[f]) {
 						// Same 4-corner check for frenzy duck
 						if ((x >= frenzyDuckX[f] && x <= frenzyDuckX[f]+19 && y >= frenzyDuckY[f] && y <= frenzyDuckY[f]+13) ||
@@ -567,27 +602,19 @@ int main()
 				//  only if NOT in frenzy: Prevents triggering new frenzy during frenzy
 				// Problem: Hitting 400 points during frenzy would trigger another frenzy immediately
 				if (!frenzyMode) {
-					if (score >= lastFrenzyScore + 200) {
-						// WHY >=: Ensures trigger even if skip exactly 200 (e.g. 0 -> 210 in one shot)
-						//  +200: Trigger every 200-point milestone (200, 400, 600, ...)
+					if (score >= lastFrenzyScore + wave->frenzyEvery) {
+						// WHY >=: Ensures trigger even if skip exactly the milestone (e.g. 0 -> 210 in one shot)
+						//  frenzyEvery: 200 on EASY (200, 400, 600, ...), other waves read their own
 						
 						frenzyMode = 1;
-						frenzyEndTime = milliseconds + 30000; 
-						//  +30000: Frenzy lasts 30 seconds (30000 milliseconds)
+						frenzyEndTime = milliseconds + wave->frenzyLength; 
+						//  frenzyLength: 30 seconds (30000 milliseconds) on the first EASY wave
 						lastFrenzyScore = score; 
 						// update: Remember this score so we don't retrigger
 						
-						//  SPAWN 3 FRENZY DUCKS 
-						for (int f = 0; f < 3; f++) {
-							frenzyDuckActive[f] = 1; // Mark as alive
-							frenzyDuckX[f] = 20 + (rand() % 80); 
-							//  20+(0-79): Random X between 20-99 (keeps ducks on screen)
-							frenzyDuckY[f] = 30 + (rand() % 60); 
-							// 30+(0-59): Random Y between 30-89
-							frenzyDuckDirX[f] = (rand() % 2) ? 1 : -1; 
-							//  Random direction, 50% chance left or right
-							// rand()%2 gives 0 or 1, ternary converts to -1 or 1
-							frenzyDuckDirY[f] = (rand() % 2) ? 1 : -1;
+						//  SPAWN THIS WAVE'S FRENZY DUCKS 
+						for (int f = 0; f < wave->frenzyDucks; f++) {
+							spawnFrenzyDuck(f);
 						}
 						
 						// Show "FRENZY!" message
@@ -649,6 +676,10 @@ int main()
 				//  Erase frenzy duck
 				frenzyDuckActive[frenzyHit] = 0; 
 				// Mark as dead (won't be drawn or checked anymore)
+				if (wave->respawnTime) {
+					frenzyRespawnTime[frenzyHit] = milliseconds + wave->respawnTime; 
+					//  Later waves send a replacement duck while frenzy is still running
+				}
 				
 				// Update score display
 				fillRectangle(5, 5, 70, 10, 0);
@@ -683,18 +714,35 @@ int main()
 			//  Prevent accidental menu button press (debouncing)
 		}
 		
-		delay(50); 
-		// 50ms: Limits loop to ~20 FPS (1000ms/50ms = 20 iterations per second)
-		// Fast enough for smooth gameplay, slow enough to not waste CPU
+		while ((milliseconds - frameStart) < wave->frameTime) {
+			__asm(" wfi ");
+		}
+		// frameTime: 60ms on first EASY wave (~17 FPS), down to 40ms on the last HARD wave
+		// Waits for whatever is LEFT of the frame instead of a fixed delay(50),
+		// so drawing 6 frenzy ducks doesn't make the game run slower than drawing 3
+		// Subtraction (not end time compare) stays correct when milliseconds wraps
 	}
   } // End outer while(1) - returns to menu
 	return 0;
 }
 
+void spawnFrenzyDuck(int f)
+{
+	frenzyDuckActive[f] = 1; // Mark as alive
+	frenzyDuckX[f] = 20 + (rand() % 80); 
+	//  20+(0-79): Random X between 20-99 (keeps ducks on screen)
+	frenzyDuckY[f] = 30 + (rand() % 60); 
+	// 30+(0-59): Random Y between 30-89
+	frenzyDuckDirX[f] = (rand() % 2) ? 1 : -1; 
+	//  Random direction, 50% chance left or right
+	// rand()%2 gives 0 or 1, ternary converts to -1 or 1
+	frenzyDuckDirY[f] = (rand() % 2) ? 1 : -1;
+}
+
 //  MENU FUNCTION
 void showMenu(void) {
 	uint8_t menuItem = 0; 
-	//  Currently selected option (0=start, 1=scores, 2=targets)
+	//  Currently selected option (0=start, 1=scores, 2=targets, 3=level)
 	
 	// Button state tracking (for debouncing)
 	static int lastUpState = 1;     
@@ -726,6 +774,11 @@ void showMenu(void) {
 			printText("TARGET SELECT", 20, 90, 
 				(menuItem == 2) ? RGBToWord(255, 0, 0) : RGBToWord(255, 255, 255), 
 				RGBToWord(0, 50, 100));
+			printText("LEVEL:", 20, 105, 
+				(menuItem == 3) ? RGBToWord(255, 0, 0) : RGBToWord(255, 255, 255), 
+				RGBToWord(0, 50, 100));
+			printText(levelNames[selectedLevel], 65, 105, RGBToWord(255, 255, 0), RGBToWord(0, 50, 100));
+			// Name comes from waves.c so the menu doesn't need to know how many levels exist
 			// ternary: Conditional color (red if selected, white if not)
 			
 			// Instructions
@@ -753,8 +806,8 @@ void showMenu(void) {
 		
 		// Handle down button (move selection down)
 		if (downPressed && lastDownState) {
-			if (menuItem < 2) menuItem++; 
-			//  <2: Can't go below third option (0,1,2 = 3 options)
+			if (menuItem < 3) menuItem++; 
+			//  <3: Can't go below fourth option (0,1,2,3 = 4 options)
 			lastDownState = 0;
 			needsRedraw = 1;
 			delay(200);
@@ -781,6 +834,10 @@ void showMenu(void) {
 			} else if (menuItem == 2) {
 				showTargetSelect(); 
 				needsRedraw = 1;
+			} else if (menuItem == 3) {
+				selectedLevel = (selectedLevel + 1) % LEVEL_COUNT; 
+				//  Cycle through levels, wraps back to EASY after the last one
+				needsRedraw = 1;
 			}
 		}
 		if (!selectPressed) lastSelectState = 1;
@@ -0,0 +1,33 @@
+#include "waves.h"
+
+// WAVE TABLE
+// const: Linker places this in flash, not RAM (only 4KB of RAM on the F031)
+// Game loop only ever reads a row from here, so adding a level or wave is a data change, no new branches
+// EASY wave 0 is the original hard-coded game: 1px duck, 3 frenzy ducks every 200 points for 30 seconds
+const Wave waveTable[LEVEL_COUNT][WAVES_PER_LEVEL] = {
+	{	// EASY
+		//score step frame every  length  ducks fstep respawn
+		{   0,   1,   60,   200,  30000,   3,    2,      0 },
+		{ 300,   1,   55,   200,  30000,   3,    2,      0 },
+		{ 600,   2,   55,   250,  25000,   4,    2,   5000 },
+		{1000,   2,   50,   250,  25000,   4,    3,   4000 },
+	},
+	{	// HARD
+		{   0,   2,   50,   150,  20000,   4,    3,   4000 },
+		{ 200,   2,   45,   150,  20000,   5,    3,   3000 },
+		{ 500,   3,   45,   200,  15000,   6,    3,   2000 },
+		{ 900,   3,   40,   200,  15000,   6,    4,   1500 },
+	},
+};
+
+const char * const levelNames[LEVEL_COUNT] = { "EASY", "HARD" };
+
+uint8_t waveForScore(uint8_t level, uint8_t wave, uint16_t score)
+{
+	// Waves only ever move forward during a game, so start from the current one
+	// Loop normally runs 0 times, at most once per wave boundary crossed
+	while (wave + 1 < WAVES_PER_LEVEL && score >= waveTable[level][wave + 1].startScore) {
+		wave++;
+	}
+	return wave;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+
+#define LEVEL_COUNT 2
+// EASY and HARD, picked from the LEVEL option on the main menu
+
+#define WAVES_PER_LEVEL 4
+// Each level is split into waves that get harder as the score climbs
+
+#define MAX_FRENZY_DUCKS 6
+// Size of the frenzy duck arrays in main.c, no wave may ask for more than this
+
+// One row of the wave table - everything the game loop needs to know about difficulty
+typedef struct {
+	uint16_t startScore;   // Wave begins once score reaches this
+	uint8_t  duckStep;     // Pixels main duck moves per frame (speed curve)
+	uint8_t  frameTime;    // Target length of one frame in ms
+	uint16_t frenzyEvery;  // Points between frenzy triggers
+	uint16_t frenzyLength; // How long a frenzy lasts in ms
+	uint8_t  frenzyDucks;  // Bonus ducks spawned per frenzy
+	uint8_t  frenzyStep;   // Pixels frenzy ducks move per frame
+	uint16_t respawnTime;  // ms before a shot frenzy duck comes back (0 = never)
+} Wave;
+
+extern const Wave waveTable[LEVEL_COUNT][WAVES_PER_LEVEL];
+extern const char * const levelNames[LEVEL_COUNT];
+
+uint8_t waveForScore(uint8_t level, uint8_t wave, uint16_t score);